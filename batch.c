@@ -0,0 +1,68 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "batch.h"
+
+#include "utils.h"
+
+void vr_batch_init(vr_batch_t* b, threads_t* t)
+{
+	b->threads    = t;
+	b->n_diagrams = t != NULL ? t->n_threads : 1;
+	b->diagrams   = CALLOC(vr_diagram_t, b->n_diagrams);
+	for (size_t i = 0; i < b->n_diagrams; i++)
+		vr_diagram_init(&b->diagrams[i], 0, 0, 0);
+
+	b->jobs = NULL;
+	b->out  = NULL;
+}
+
+void vr_batch_exit(vr_batch_t* b)
+{
+	for (size_t i = 0; i < b->n_diagrams; i++)
+		vr_diagram_exit(&b->diagrams[i]);
+	free(b->diagrams);
+}
+
+static void build(void* arg, size_t thread, size_t a, size_t b)
+{
+	vr_batch_t* bt = (vr_batch_t*) arg;
+	vr_diagram_t* v = &bt->diagrams[thread];
+
+	for (size_t i = a; i < b; i++)
+	{
+		const vr_job_t* j = &bt->jobs[i];
+		vr_diagram_reset(v);
+		v->width  = j->width;
+		v->height = j->height;
+		vr_diagram_points(v, j->n, j->sites);
+		vr_diagram_end(v);
+		vr_flat_build(&bt->out[i], v);
+	}
+}
+
+void vr_batch_run(vr_batch_t* b, size_t n, const vr_job_t* jobs, vr_flat_t* out)
+{
+	b->jobs = jobs;
+	b->out  = out;
+
+	if (b->threads != NULL)
+		threads_run(b->threads, n, build, b);
+	else
+		build(b, 0, 0, n);
+}
@@ -0,0 +1,61 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+typedef struct vr_job   vr_job_t;
+typedef struct vr_batch vr_batch_t;
+
+#include "voronoi.h"
+#include "flat.h"
+#include "threads.h"
+
+// the sites of a diagram to build, in a width x height box
+struct vr_job
+{
+	double         width;
+	double         height;
+	size_t         n;
+	const point_t* sites;
+};
+
+// builds many independent diagrams on a thread pool; each thread has
+// its own diagram, which is reset from one job to the next so that its
+// memory is reused
+struct vr_batch
+{
+	threads_t*    threads;
+	size_t        n_diagrams;
+	vr_diagram_t* diagrams; // one per thread
+
+	// current run
+	const vr_job_t* jobs;
+	vr_flat_t*      out;
+};
+
+// t may be NULL to run on the calling thread
+void vr_batch_init(vr_batch_t* b, threads_t* t);
+void vr_batch_exit(vr_batch_t* b);
+
+// build the diagrams of the n jobs into out[0..n-1], which must have
+// been initialized with vr_flat_init(); their arrays are reused when
+// the same out is passed again
+void vr_batch_run(vr_batch_t* b, size_t n, const vr_job_t* jobs, vr_flat_t* out);
+
+#endif
@@ -0,0 +1,112 @@
+#!/bin/bash
+# Sweep timings for growing inputs; for an O(n log n) sweep the
+# "ns per site log site" column should stay roughly constant.
+#
+# usage: ./bench.sh [max sites]
+#        ./bench.sh stress [sites]
+#        ./bench.sh scaling [sites]
+#        ./bench.sh batch [diagrams]
+#        ./bench.sh file [sites]
+#        ./bench.sh clip [max sites]
+#        ./bench.sh bounded [max sites]
+#
+# The stress run relaxes a large diagram (10M sites by default, which
+# needs several GiB of memory) with the default 8 MiB stack, to check
+# that relaxation does not depend on the stack size.
+#
+# The scaling run builds the diagram by slabs (1M sites by default) on
+# 1 to 64 threads, timed by the wall clock.
+#
+# The batch run builds many small diagrams (10000 by default) on all
+# the processors and prints how many are done per second.
+#
+# The file run dumps sites to a file (10M by default), sorts it with
+# vrsort in 64 MiB, and streams the diagram from the sorted file.
+#
+# The clip run times the end of the sweep (clipping and linking) for
+# growing fans of sites, where one cell has an edge for each site, and
+# for uniform sites; the "ns per site" of the end should stay roughly
+# constant.
+#
+# The bounded run times the sweep of clustered sites with long tails
+# right of the box, in full and stopped once the box is passed.
+
+make -s || exit 1
+
+if [ "$1" = stress ]
+then
+	n=${2:-10000000}
+	ulimit -s 8192
+	./voronoi --nogui --stats --lloyd 3 $n 2>&1 | grep -v "^Lloyd step"
+	exit
+fi
+
+if [ "$1" = scaling ]
+then
+	n=${2:-1000000}
+	for t in 1 2 4 8 16 32 64
+	do
+		./voronoi --nogui --stats --threads $t --parallel 0 $n 2>&1
+	done
+	exit
+fi
+
+if [ "$1" = file ]
+then
+	n=${2:-10000000}
+	tmp=$(mktemp -d) || exit 1
+	./voronoi --dump $tmp/sites $n
+	time ./vrsort --memory 64 $tmp/sites $tmp/sorted
+	./voronoi --stats --file $tmp/sorted
+	rm -r $tmp
+	exit
+fi
+
+if [ "$1" = clip ]
+then
+	max=${2:-1000000}
+	for dist in fan uniform
+	do
+		echo "== $dist"
+		for ((n = 10000; n <= max; n *= 10))
+		do
+			./voronoi --nogui --stats --input $dist $n 2>&1 | head -n1
+		done
+	done
+	exit
+fi
+
+if [ "$1" = bounded ]
+then
+	max=${2:-1000000}
+	for ((n = 10000; n <= max; n *= 10))
+	do
+		for opt in "" --bounded
+		do
+			echo "== $n $opt"
+			./voronoi --nogui --stats --input cluster $opt $n 2>&1 | grep "sites in\|event queue"
+		done
+	done
+	exit
+fi
+
+if [ "$1" = batch ]
+then
+	b=${2:-10000}
+	for n in 50 500 5000
+	do
+		./voronoi --nogui --batch $b $n
+	done
+	exit
+fi
+
+max=${1:-1000000}
+
+for dist in uniform sorted grid
+do
+	echo "== $dist"
+	for ((n = 10000; n <= max; n *= 10))
+	do
+		./voronoi --nogui --stats --input $dist $n 2>&1 | head -n1
+	done
+done
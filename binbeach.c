@@ -24,30 +24,321 @@
 void vr_binbeach_init(vr_binbeach_t* b)
 {
 	b->root = NULL;
+	b->head = NULL;
+
+	b->slabs     = NULL;
+	b->slab_used = VR_BSLAB_SIZE;
+	b->free      = NULL;
+	b->spare     = NULL;
+
+	b->n_alloc  = 0;
+	b->n_reused = 0;
+	b->n_slabs  = 0;
 }
 
-static void exit_aux(vr_bnode_t* n)
+static void free_slabs(vr_bslab_t* s)
 {
-	if (n == NULL)
-		return;
-
-	exit_aux(n->left);
-	exit_aux(n->right);
-	free(n);
+	while (s != NULL)
+	{
+		vr_bslab_t* next = s->next;
+		free(s);
+		s = next;
+	}
 }
+
 void vr_binbeach_exit(vr_binbeach_t* b)
 {
-	exit_aux(b->root);
+	free_slabs(b->slabs);
+	free_slabs(b->spare);
+}
+
+void vr_binbeach_reset(vr_binbeach_t* b)
+{
+	// move the slabs in use to the spare list
+	while (b->slabs != NULL)
+	{
+		vr_bslab_t* s = b->slabs;
+		b->slabs = s->next;
+		s->next = b->spare;
+		b->spare = s;
+	}
+
+	b->root      = NULL;
+	b->head      = NULL;
+	b->slab_used = VR_BSLAB_SIZE;
+	b->free      = NULL;
+
+	b->n_alloc  = 0;
+	b->n_reused = 0;
+}
+
+static vr_bnode_t* new_node(vr_binbeach_t* b)
+{
+	b->n_alloc++;
+
+	// reuse a released node
+	if (b->free != NULL)
+	{
+		vr_bnode_t* n = b->free;
+		b->free = n->parent;
+		b->n_reused++;
+		return n;
+	}
+
+	// carve a new slab if needed
+	if (b->slab_used == VR_BSLAB_SIZE)
+	{
+		vr_bslab_t* s = b->spare;
+		if (s != NULL)
+			b->spare = s->next;
+		else
+		{
+			s = CALLOC(vr_bslab_t, 1);
+			b->n_slabs++;
+		}
+		s->next = b->slabs;
+		b->slabs = s;
+		b->slab_used = 0;
+	}
+	return &b->slabs->nodes[b->slab_used++];
+}
+
+static void free_node(vr_binbeach_t* b, vr_bnode_t* n)
+{
+	n->parent = b->free;
+	b->free = n;
+}
+
+static vr_bnode_t* new_arc(vr_binbeach_t* b, struct vr_region* r)
+{
+	vr_bnode_t* n = new_node(b);
+	*n = (vr_bnode_t){r, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, 0};
+	return n;
+}
+
+// put m in place of n in the tree
+static void replace(vr_binbeach_t* b, vr_bnode_t* n, vr_bnode_t* m)
+{
+	vr_bnode_t* p = n->parent;
+	if (p == NULL)
+		b->root = m;
+	else if (n == p->left)
+		p->left = m;
+	else
+		p->right = m;
+	m->parent = p;
+}
+
+static void rotate_left(vr_binbeach_t* b, vr_bnode_t* n)
+{
+	vr_bnode_t* r = n->right;
+	replace(b, n, r);
+	n->right = r->left;
+	n->right->parent = n;
+	r->left = n;
+	n->parent = r;
+}
+
+static void rotate_right(vr_binbeach_t* b, vr_bnode_t* n)
+{
+	vr_bnode_t* l = n->left;
+	replace(b, n, l);
+	n->left = l->right;
+	n->left->parent = n;
+	l->right = n;
+	n->parent = l;
+}
+
+static char is_red(vr_bnode_t* n)
+{
+	return n != NULL && n->red;
+}
+
+// restore the red-black properties after red node n was inserted
+static void insert_fixup(vr_binbeach_t* b, vr_bnode_t* n)
+{
+	while (is_red(n->parent))
+	{
+		vr_bnode_t* p = n->parent;
+		vr_bnode_t* g = p->parent; // p is red, hence not the root
+		if (p == g->left)
+		{
+			vr_bnode_t* u = g->right;
+			if (u->red)
+			{
+				p->red = 0;
+				u->red = 0;
+				g->red = 1;
+				n = g;
+				continue;
+			}
+			if (n == p->right)
+			{
+				rotate_left(b, p);
+				n = p;
+				p = n->parent;
+			}
+			p->red = 0;
+			g->red = 1;
+			rotate_right(b, g);
+		}
+		else
+		{
+			vr_bnode_t* u = g->left;
+			if (u->red)
+			{
+				p->red = 0;
+				u->red = 0;
+				g->red = 1;
+				n = g;
+				continue;
+			}
+			if (n == p->left)
+			{
+				rotate_right(b, p);
+				n = p;
+				p = n->parent;
+			}
+			p->red = 0;
+			g->red = 1;
+			rotate_left(b, g);
+		}
+	}
+	b->root->red = 0;
+}
+
+// restore the red-black properties after a black node was spliced out
+// and replaced by n, which now carries an extra black
+static void remove_fixup(vr_binbeach_t* b, vr_bnode_t* n)
+{
+	while (n != b->root && !n->red)
+	{
+		vr_bnode_t* p = n->parent;
+		if (n == p->left)
+		{
+			vr_bnode_t* s = p->right;
+			if (s->red)
+			{
+				s->red = 0;
+				p->red = 1;
+				rotate_left(b, p);
+				s = p->right;
+			}
+			if (!is_red(s->left) && !is_red(s->right))
+			{
+				s->red = 1;
+				n = p;
+				continue;
+			}
+			if (!is_red(s->right))
+			{
+				s->left->red = 0;
+				s->red = 1;
+				rotate_right(b, s);
+				s = p->right;
+			}
+			s->red = p->red;
+			p->red = 0;
+			s->right->red = 0;
+			rotate_left(b, p);
+			n = b->root;
+		}
+		else
+		{
+			vr_bnode_t* s = p->left;
+			if (s->red)
+			{
+				s->red = 0;
+				p->red = 1;
+				rotate_right(b, p);
+				s = p->left;
+			}
+			if (!is_red(s->left) && !is_red(s->right))
+			{
+				s->red = 1;
+				n = p;
+				continue;
+			}
+			if (!is_red(s->left))
+			{
+				s->right->red = 0;
+				s->red = 1;
+				rotate_left(b, s);
+				s = p->left;
+			}
+			s->red = p->red;
+			p->red = 0;
+			s->left->red = 0;
+			rotate_right(b, p);
+			n = b->root;
+		}
+	}
+	n->red = 0;
+}
+
+// insert arc m right after arc n
+static void insert_after(vr_binbeach_t* b, vr_bnode_t* n, vr_bnode_t* m)
+{
+	vr_bnode_t* i = new_node(b);
+	replace(b, n, i);
+	i->r1    = n->r1;
+	i->r2    = m->r1;
+	i->left  = n;
+	i->right = m;
+	i->end   = NULL;
+	i->edge  = NULL;
+	i->event = 0;
+	i->red   = 1;
+	n->parent = i;
+	m->parent = i;
+
+	// thread m after n
+	m->prev   = n;
+	m->next   = n->next;
+	m->lbreak = i;
+	m->rbreak = n->rbreak;
+	if (n->next != NULL)
+		n->next->prev = m;
+	n->next   = m;
+	n->rbreak = i;
+
+	insert_fixup(b, i);
+}
+
+// insert arc m right before arc n, the first one
+static void insert_first(vr_binbeach_t* b, vr_bnode_t* n, vr_bnode_t* m)
+{
+	vr_bnode_t* i = new_node(b);
+	replace(b, n, i);
+	i->r1    = m->r1;
+	i->r2    = n->r1;
+	i->left  = m;
+	i->right = n;
+	i->end   = NULL;
+	i->edge  = NULL;
+	i->event = 0;
+	i->red   = 1;
+	n->parent = i;
+	m->parent = i;
+
+	m->prev   = NULL;
+	m->next   = n;
+	m->lbreak = NULL;
+	m->rbreak = i;
+	n->prev   = m;
+	n->lbreak = i;
+	b->head   = m;
+
+	insert_fixup(b, i);
 }
 
 vr_bnode_t* vr_binbeach_breakAt(vr_binbeach_t* b, double sweep, struct vr_region* r)
 {
 	if (b->root == NULL)
 	{
-		vr_bnode_t* n = CALLOC(vr_bnode_t, 1);
-		*n = (vr_bnode_t){r, NULL, NULL, NULL, NULL, NULL, NULL};
-		b->root = n;
-		return n;
+		b->root = new_arc(b, r);
+		b->head = b->root;
+		return b->root;
 	}
 
 	// find the intersecting arc
@@ -63,35 +354,41 @@ vr_bnode_t* vr_binbeach_breakAt(vr_binbeach_t* b, double sweep, struct vr_region
 			n = n->right;
 	}
 
-	// left leaf (original region)
-	vr_bnode_t* ll = CALLOC(vr_bnode_t, 1);
-	*ll = (vr_bnode_t){n->r1, NULL, NULL, NULL, n, NULL, n->event};
-	n->left = ll;
-
-	// new internal node
-	vr_bnode_t* ni = CALLOC(vr_bnode_t, 1);
-
-	// middle leaf (new region)
-	vr_bnode_t* ml = CALLOC(vr_bnode_t, 1);
-	*ml = (vr_bnode_t){r, NULL, NULL, NULL, ni, NULL, NULL};
-
-	// right leaf (original region)
-	vr_bnode_t* rl = CALLOC(vr_bnode_t, 1);
-	*rl = (vr_bnode_t){n->r1, NULL, NULL, NULL, ni, NULL, n->event};
-
-	// filling new internal node
-	*ni = (vr_bnode_t){r, n->r1, ml, rl, n, NULL, NULL};
+	// while the sweepline is on the first sites, their arcs are
+	// horizontal rays, ordered by ordinate, and are not split: the new
+	// arc goes next to n, on the side of r, and the breakpoint that was
+	// there now has it on its left
+	if (n->r1->p.x == sweep)
+	{
+		vr_bnode_t* m = new_arc(b, r);
+		if (y < n->r1->p.y)
+			n = n->prev;
+		if (n == NULL)
+			insert_first(b, b->head, m);
+		else
+		{
+			insert_after(b, n, m);
+			if (m->rbreak != NULL)
+				m->rbreak->r1 = r;
+		}
+		return m;
+	}
 
-	// filling old leaf node (now internal)
-	n->r2    = r;
-	n->left  = ll;
-	n->right = ni;
+	// the arc n keeps the left part (and its event, to be
+	// discarded by the caller); new arcs for the new region
+	// and for the right part of the original one
+	vr_bnode_t* ml = new_arc(b, r);
+	vr_bnode_t* rl = new_arc(b, n->r1);
+	insert_after(b, n,  ml);
+	insert_after(b, ml, rl);
 
-	return n;
+	return ml;
 }
 
 vr_bnode_t* vr_bnode_left(vr_bnode_t* n)
 {
+	if (n->left == NULL)
+		return n->rbreak;
 	while (n->parent != NULL && n != n->parent->left)
 		n = n->parent;
 	return n->parent;
@@ -99,34 +396,14 @@ vr_bnode_t* vr_bnode_left(vr_bnode_t* n)
 
 vr_bnode_t* vr_bnode_right(vr_bnode_t* n)
 {
+	if (n->left == NULL)
+		return n->lbreak;
 	while (n->parent != NULL && n != n->parent->right)
 		n = n->parent;
 	return n->parent;
 }
 
-vr_bnode_t* vr_bnode_prev(vr_bnode_t* n)
-{
-	n = vr_bnode_right(n);
-	if (n == NULL)
-		return NULL;
-	n = n->left;
-	while (n->right != NULL)
-		n = n->right;
-	return n;
-}
-
-vr_bnode_t* vr_bnode_next(vr_bnode_t* n)
-{
-	n = vr_bnode_left(n);
-	if (n == NULL)
-		return NULL;
-	n = n->right;
-	while (n->left != NULL)
-		n = n->left;
-	return n;
-}
-
-vr_bnode_t* vr_bnode_remove(vr_bnode_t* n)
+vr_bnode_t* vr_bnode_remove(vr_binbeach_t* b, vr_bnode_t* n)
 {
 	vr_bnode_t* p = n->parent;
 
@@ -137,25 +414,29 @@ vr_bnode_t* vr_bnode_remove(vr_bnode_t* n)
 	if (n == p->left)
 	{
 		s = p->right;
-		a = vr_bnode_right(n);
+		a = n->lbreak;
 		a->r2 = p->r2;
+		n->next->lbreak = a;
 	}
 	else
 	{
 		s = p->left;
-		a = vr_bnode_left(n);
+		a = n->rbreak;
 		a->r1 = p->r1;
+		n->prev->rbreak = a;
 	}
 
-	// find where to put sibling
-	vr_bnode_t* pp = p->parent;
-	vr_bnode_t** x = p == pp->left ? &pp->left  : &pp->right;
+	// unthread n
+	n->prev->next = n->next;
+	n->next->prev = n->prev;
 
-	*x = s;
-	s->parent = pp;
+	// put sibling in place of parent
+	replace(b, p, s);
+	if (!p->red)
+		remove_fixup(b, s);
 
-	free(n);
-	free(p);
+	free_node(b, n);
+	free_node(b, p);
 
 	return a;
 }
@@ -23,15 +23,21 @@ typedef struct vr_bnode    vr_bnode_t;
 typedef struct vr_binbeach vr_binbeach_t;
 
 #include <sys/types.h>
+#include <stdint.h>
 
 #include "geometry.h"
 
 struct vr_region;
-struct vr_event;
+struct vr_edge;
 
 // internal nodes are breakpoints
 // (two regions, two children, 'end' set)
 // leaves are arcs (one region, no child, 'event' set)
+//
+// the breakpoints form a red-black tree whose external nodes are the
+// arcs (always black); rotations keep the in-order sequence, so each
+// breakpoint still separates the last arc on its left from the first
+// arc on its right
 struct vr_bnode
 {
 	struct vr_region* r1;
@@ -41,30 +47,80 @@ struct vr_bnode
 	vr_bnode_t* right;
 	vr_bnode_t* parent;
 
-	// linked point id
-	point_t** end;
+	// arcs are threaded in beachline order and
+	// know the breakpoints on their both sides
+	vr_bnode_t* prev;
+	vr_bnode_t* next;
+	vr_bnode_t* lbreak;
+	vr_bnode_t* rbreak;
 
-	struct vr_event* event;
+	// linked point id, and the edge it belongs to
+	point_t**       end;
+	struct vr_edge* edge;
+
+	// pending circle event, 0 if none
+	uint32_t event;
+
+	char red;
+};
+
+// nodes are carved out of slabs of VR_BSLAB_SIZE nodes; released nodes
+// are chained through their 'parent' field and reused first; a reset
+// keeps the slabs aside to carve them again
+#define VR_BSLAB_SIZE 1024
+
+typedef struct vr_bslab vr_bslab_t;
+struct vr_bslab
+{
+	vr_bslab_t* next;
+	vr_bnode_t  nodes[VR_BSLAB_SIZE];
 };
 
 struct vr_binbeach
 {
 	vr_bnode_t* root;
+	vr_bnode_t* head; // first arc; arcs are only removed between two
+	                  // others, and only added first on the first sites
+
+	// node pool
+	vr_bslab_t* slabs;
+	size_t      slab_used; // nodes used in the first slab
+	vr_bnode_t* free;
+	vr_bslab_t* spare; // slabs kept by vr_binbeach_reset()
+
+	// allocator statistics
+	size_t n_alloc;  // nodes requested
+	size_t n_reused; // nodes served from the free list
+	size_t n_slabs;  // slabs allocated
 };
 
 void vr_binbeach_init(vr_binbeach_t* b);
 void vr_binbeach_exit(vr_binbeach_t* b);
 
+// empty the beachline, keeping the slabs
+void vr_binbeach_reset(vr_binbeach_t* b);
+
+// split the arc above the site of region r, return the new arc; the
+// arc of a site on the sweepline is not split, the new arc being put
+// next to it instead
 vr_bnode_t* vr_binbeach_breakAt(vr_binbeach_t* b, double sweep, struct vr_region* r);
 
 // vr_bnode_X finds closest ancestor of n for which n is X to
+// (constant time for arcs)
 vr_bnode_t* vr_bnode_left (vr_bnode_t* n);
 vr_bnode_t* vr_bnode_right(vr_bnode_t* n);
 
-vr_bnode_t* vr_bnode_prev(vr_bnode_t* n);
-vr_bnode_t* vr_bnode_next(vr_bnode_t* n);
+// previous and next arcs of arc n
+static inline vr_bnode_t* vr_bnode_prev(vr_bnode_t* n)
+{
+	return n->prev;
+}
+static inline vr_bnode_t* vr_bnode_next(vr_bnode_t* n)
+{
+	return n->next;
+}
 
 // remove an arc, return the new breakpoint
-vr_bnode_t* vr_bnode_remove(vr_bnode_t* n);
+vr_bnode_t* vr_bnode_remove(vr_binbeach_t* b, vr_bnode_t* n);
 
 #endif
@@ -0,0 +1,157 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "flat.h"
+
+#include <stdlib.h>
+
+#include "utils.h"
+
+void vr_flat_init(vr_flat_t* f)
+{
+	*f = (vr_flat_t){0, NULL, NULL, 0, NULL, NULL, NULL, NULL, 0, NULL, NULL};
+}
+
+void vr_flat_exit(vr_flat_t* f)
+{
+	free(f->vx);
+	free(f->vy);
+	free(f->ea);
+	free(f->eb);
+	free(f->ra);
+	free(f->rb);
+	free(f->sx);
+	free(f->sy);
+}
+
+static uint32_t region_id(vr_region_t* r)
+{
+	return r == NULL ? VR_FLAT_NONE : (uint32_t) r->id;
+}
+
+static uint32_t vertex_id(point_t* p)
+{
+	return ((vr_vertex_t*) p)->id;
+}
+
+void vr_flat_build(vr_flat_t* f, vr_diagram_t* v)
+{
+	f->n_vertices = v->n_vertices;
+	f->vx = CREALLOC(f->vx, double, f->n_vertices);
+	f->vy = CREALLOC(f->vy, double, f->n_vertices);
+	for (uint32_t i = 0; i < f->n_vertices; i++)
+	{
+		f->vx[i] = v->vertices[i]->p.x;
+		f->vy[i] = v->vertices[i]->p.y;
+	}
+
+	f->n_edges = v->n_edges;
+	f->ea = CREALLOC(f->ea, uint32_t, f->n_edges);
+	f->eb = CREALLOC(f->eb, uint32_t, f->n_edges);
+	f->ra = CREALLOC(f->ra, uint32_t, f->n_edges);
+	f->rb = CREALLOC(f->rb, uint32_t, f->n_edges);
+	for (uint32_t i = 0; i < f->n_edges; i++)
+	{
+		vr_edge_t* e = v->edges[i];
+		f->ea[i] = vertex_id(e->s.a);
+		f->eb[i] = vertex_id(e->s.b);
+		f->ra[i] = region_id(e->ra);
+		f->rb[i] = region_id(e->rb);
+	}
+
+	f->n_regions = v->n_regions;
+	f->sx = CREALLOC(f->sx, double, f->n_regions);
+	f->sy = CREALLOC(f->sy, double, f->n_regions);
+	for (uint32_t i = 0; i < f->n_regions; i++)
+	{
+		f->sx[i] = v->regions[i]->p.x;
+		f->sy[i] = v->regions[i]->p.y;
+	}
+}
+
+typedef struct fkey fkey_t;
+struct fkey
+{
+	uint32_t r[2]; // regions, in order
+	double   p[4]; // ends, in order
+};
+
+static int cmp_fkey(const void* a, const void* b)
+{
+	const fkey_t* ka = (const fkey_t*) a;
+	const fkey_t* kb = (const fkey_t*) b;
+	for (int i = 0; i < 2; i++)
+		if (ka->r[i] != kb->r[i])
+			return ka->r[i] < kb->r[i] ? -1 : 1;
+	for (int i = 0; i < 4; i++)
+		if (ka->p[i] != kb->p[i])
+			return ka->p[i] < kb->p[i] ? -1 : 1;
+	return 0;
+}
+
+// edges of f as sorted keys
+static fkey_t* flat_keys(vr_flat_t* f)
+{
+	fkey_t* k = CALLOC(fkey_t, f->n_edges);
+	for (uint32_t i = 0; i < f->n_edges; i++)
+	{
+		uint32_t ra = f->ra[i];
+		uint32_t rb = f->rb[i];
+		point_t a = vr_flat_edgeA(f, i);
+		point_t b = vr_flat_edgeB(f, i);
+		if (b.x < a.x || (b.x == a.x && b.y < a.y))
+		{
+			point_t t = a;
+			a = b;
+			b = t;
+		}
+		k[i] = (fkey_t){{ra < rb ? ra : rb, ra < rb ? rb : ra}, {a.x, a.y, b.x, b.y}};
+	}
+	if (f->n_edges != 0)
+		qsort(k, f->n_edges, sizeof(fkey_t), cmp_fkey);
+	return k;
+}
+
+size_t vr_flat_diff(vr_flat_t* a, vr_flat_t* b)
+{
+	fkey_t* ka = flat_keys(a);
+	fkey_t* kb = flat_keys(b);
+	size_t i = 0;
+	size_t j = 0;
+	size_t n = 0;
+	while (i < a->n_edges && j < b->n_edges)
+	{
+		int c = cmp_fkey(&ka[i], &kb[j]);
+		i += c <= 0;
+		j += c >= 0;
+		n += c != 0;
+	}
+	n += (a->n_edges - i) + (b->n_edges - j);
+	free(kb);
+	free(ka);
+	return n;
+}
+
+size_t vr_flat_size(vr_flat_t* f)
+{
+	return
+	2 * sizeof(double)   * f->n_vertices +
+	4 * sizeof(uint32_t) * f->n_edges    +
+	2 * sizeof(double)   * f->n_regions  +
+	0;
+}
@@ -0,0 +1,81 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef FLAT_H
+#define FLAT_H
+
+typedef struct vr_flat vr_flat_t;
+
+#include <stdint.h>
+
+#include "voronoi.h"
+
+#define VR_FLAT_NONE UINT32_MAX
+
+// compact copy of a finished diagram: coordinates are kept in separate
+// arrays and edges refer to their vertices and regions by 32-bit index
+// (VR_FLAT_NONE for the outer side of border edges)
+struct vr_flat
+{
+	uint32_t n_vertices;
+	double*  vx;
+	double*  vy;
+
+	uint32_t  n_edges;
+	uint32_t* ea; // first vertex
+	uint32_t* eb; // second vertex
+	uint32_t* ra; // first region
+	uint32_t* rb; // second region
+
+	uint32_t n_regions;
+	double*  sx; // sites
+	double*  sy;
+};
+
+void vr_flat_init(vr_flat_t* f);
+void vr_flat_exit(vr_flat_t* f);
+
+// (re)fill f from v, after vr_diagram_end()
+void vr_flat_build(vr_flat_t* f, vr_diagram_t* v);
+
+// memory used by the arrays
+size_t vr_flat_size(vr_flat_t* f);
+
+// number of edges of a or of b that the other does not have, edges
+// being the same when they separate the same regions and have their
+// ends at the same positions (in any order)
+size_t vr_flat_diff(vr_flat_t* a, vr_flat_t* b);
+
+static inline point_t vr_flat_vertex(vr_flat_t* f, uint32_t i)
+{
+	return (point_t){f->vx[i], f->vy[i]};
+}
+static inline point_t vr_flat_site(vr_flat_t* f, uint32_t i)
+{
+	return (point_t){f->sx[i], f->sy[i]};
+}
+static inline point_t vr_flat_edgeA(vr_flat_t* f, uint32_t i)
+{
+	return vr_flat_vertex(f, f->ea[i]);
+}
+static inline point_t vr_flat_edgeB(vr_flat_t* f, uint32_t i)
+{
+	return vr_flat_vertex(f, f->eb[i]);
+}
+
+#endif
@@ -30,6 +30,11 @@ double point_cross(point_t a, point_t b)
 	return a.x*b.y - a.y*b.x;
 }
 
+double point_dot(point_t a, point_t b)
+{
+	return a.x*b.x + a.y*b.y;
+}
+
 point_t point_centroid(int n, point_t* pts)
 {
 	point_t ret = {0,0};
@@ -49,6 +54,19 @@ point_t point_centroid(int n, point_t* pts)
 	return ret;
 }
 
+double point_moment(int n, point_t* pts, point_t c)
+{
+	double I = 0;
+	for (int i=0, j=n-1; i < n; j=i++)
+	{
+		point_t p = point_minus(pts[j], c);
+		point_t q = point_minus(pts[i], c);
+		double f = p.x*q.y - q.x*p.y;
+		I += f * (p.x*p.x + p.x*q.x + q.x*q.x + p.y*p.y + p.y*q.y + q.y*q.y);
+	}
+	return fabs(I) / 12;
+}
+
 /*
 Parabolas are defined as being the set of points equidistant from a
 vertex (focus) and a line (directrix). It is exactly what we need for
@@ -128,6 +146,61 @@ char parabola_intersect(point_t* dst, const point_t* f1, const point_t* f2, doub
 	return 1;
 }
 
+// batched functions are cloned for AVX2 (the 'default' clone gets
+// SSE2 on x86-64), the best one being picked when loaded; they are
+// vectorised without contraction, and give the same results as their
+// scalar versions
+#if defined(__GNUC__) && defined(__x86_64__)
+#define VECTOR_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define VECTOR_CLONES
+#endif
+
+// the special cases of parabola_intersect() are blended in instead of
+// branched to, so that the loop can be vectorised
+VECTOR_CLONES
+void parabola_intersect_n(size_t n, double* restrict x, double* restrict y,
+	const double* restrict x1, const double* restrict y1,
+	const double* restrict x2, const double* restrict y2, double p)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		double ax = x1[i], ay = y1[i];
+		double bx = x2[i], by = y2[i];
+
+		double r = (bx-p)/(ax-p);
+		double d1 = ax*ax - p*p + ay*ay;
+		double d2 = bx*bx - p*p + by*by;
+
+		double qa = r-1;
+		double qb = 2*(by - ay*r);
+		double qc = d1*r - d2;
+		double delta = qb*qb - 4*qa*qc;
+		double yi = (-qb + sqrt(delta)) / (2*qa);
+
+		double fx = ax;
+		double fy = ay;
+		double none = delta < 0 ? 1 : 0;
+
+		// f1 on the directrix
+		yi   = ax == p ? ay : yi;
+		fx   = ax == p ? bx : fx;
+		fy   = ax == p ? by : fy;
+		none = ax == p ? 0  : none;
+
+		// focuses of the same abscissa
+		yi   = ax == bx ? (ay+by)/2 : yi;
+		fx   = ax == bx ? ax : fx;
+		fy   = ax == bx ? ay : fy;
+		none = ax == bx ? 0  : none;
+
+		double t = yi-fy;
+		double xi = (fx*fx - p*p + t*t) / (2*(fx-p));
+		x[i] = none != 0 ? 0 : xi;
+		y[i] = none != 0 ? 0 : yi;
+	}
+}
+
 /*
 Consider circle of center (x,y) and radius r. We are given three points
 p1, p2 and p3 and want to find back the center an the radius. We have:
@@ -191,6 +264,35 @@ char circle_from3(point_t* c, double* r, const point_t* p1, const point_t* p2, c
 	return 1;
 }
 
+// the non-collinear cases of circle_from3() are blended in, so that the
+// loop can be vectorised
+VECTOR_CLONES
+void circle_from3_n(size_t n, double* restrict cx, double* restrict cy, double* restrict r,
+	const double* restrict x1, const double* restrict y1,
+	const double* restrict x2, const double* restrict y2,
+	const double* restrict x3, const double* restrict y3)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		double A = x2[i] - x1[i], B = y2[i] - y1[i],
+		       C = x3[i] - x1[i], D = y3[i] - y1[i],
+		       E = A*(x1[i]+x2[i]) + B*(y1[i]+y2[i]),
+		       F = C*(x1[i]+x3[i]) + D*(y1[i]+y3[i]),
+		       G = 2*(A*(y3[i]-y2[i]) - B*(x3[i]-x2[i]));
+
+		double x = (D*E-B*F)/G;
+		double y = (A*F-C*E)/G;
+		double dx = x1[i] - x;
+		double dy = y1[i] - y;
+		double ri = sqrt(dx*dx+dy*dy);
+
+		double none = A*D - C*B > 0 || G == 0 ? 1 : 0;
+		cx[i] = none != 0 ? 0 : x;
+		cy[i] = none != 0 ? 0 : y;
+		r[i]  = none != 0 ? -1 : ri;
+	}
+}
+
 // http://stackoverflow.com/questions/563198/how-do-you-detect-where-two-line-segments-intersect/565282#565282
 char segment_intersect(point_t* dst, const segment_t* a, const segment_t* b)
 {
@@ -19,6 +19,8 @@
 #ifndef GEOMETRY_H
 #define GEOMETRY_H
 
+#include <stddef.h>
+
 typedef struct point   point_t;
 typedef struct segment segment_t;
 
@@ -36,16 +38,36 @@ struct segment
 
 point_t point_minus   (point_t a, point_t b);
 double  point_cross   (point_t a, point_t b);
+double  point_dot     (point_t a, point_t b);
 point_t point_centroid(int n, point_t* pts);
 
+// second moment of a polygon about point c: the integral
+// of |x-c|^2 over its surface
+double  point_moment  (int n, point_t* pts, point_t c);
+
 // compute the parabola_intersect of two parabola of
 // focuses f1 and f2 and common directrix x=p
 char parabola_intersect(point_t* dst, const point_t* f1, const point_t* f2, double p);
 
+// the same for n pairs of focuses (x1[i],y1[i]) and (x2[i],y2[i]) at
+// once, into (x[i],y[i]); both are 0 when parabola_intersect() would
+// return 0 for pair i
+void parabola_intersect_n(size_t n, double* restrict x, double* restrict y,
+	const double* restrict x1, const double* restrict y1,
+	const double* restrict x2, const double* restrict y2, double p);
+
 // compute the center c and radius r of a circle
 // passing through three given point p1, p2 and p3
 char circle_from3(point_t* c, double* r, const point_t* p1, const point_t* p2, const point_t* p3);
 
+// the same for n triples of points at once, into (cx[i],cy[i]) and
+// r[i]; r[i] is -1 (and the center 0) when circle_from3() would return
+// 0 for triple i
+void circle_from3_n(size_t n, double* restrict cx, double* restrict cy, double* restrict r,
+	const double* restrict x1, const double* restrict y1,
+	const double* restrict x2, const double* restrict y2,
+	const double* restrict x3, const double* restrict y3);
+
 // compute the parabola_intersect between two segments
 char segment_intersect(point_t* dst, const segment_t* a, const segment_t* b);
 
@@ -16,110 +16,156 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 \*/
 
+#define _POSIX_C_SOURCE 200112L // posix_memalign()
 #include "heap.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+#include "utils.h"
+
+// the tree starts HEAP_SKIP nodes into a block aligned on a cache line;
+// nodes being 16 bytes, the children 4i+1 to 4i+4 of node i are then
+// the 4 nodes of the line starting 4(i+1) nodes into the block
+#define HEAP_LINE 64
+#define HEAP_SKIP 3
+
+static hnode_t* alloc_tree(size_t n)
+{
+	void* p;
+	if (posix_memalign(&p, HEAP_LINE, (n + HEAP_SKIP) * sizeof(hnode_t)) != 0)
+	{
+		fprintf(stderr, "Could not allocate memory at '%s' line %i\n", __FILE__, __LINE__);
+		exit(1);
+	}
+	return (hnode_t*) p + HEAP_SKIP;
+}
+static void free_tree(hnode_t* tree)
+{
+	if (tree != NULL)
+		free(tree - HEAP_SKIP);
+}
+
 void heap_init(heap_t* h)
 {
 	h->size  = 0;
 	h->avail = 0;
 	h->tree  = NULL;
+	h->n_pos = 0;
+	h->pos   = NULL;
+	h->peak  = 0;
 }
 
 void heap_exit(heap_t* h)
 {
-	free(h->tree);
+	free(h->pos);
+	free_tree(h->tree);
 }
 
-static inline int max(int a, int b)
+void heap_reset(heap_t* h)
 {
-	return a > b ? a : b;
+	h->size = 0;
+	h->peak = 0;
 }
+
 static inline size_t parent(size_t i)
 {
-	return max(0, ((ssize_t)i+1)/2-1);
-}
-static inline size_t left(size_t i)
-{
-	return 2*i+1;
+	return (i-1)/4;
 }
-static inline size_t right(size_t i)
+static inline size_t child(size_t i)
 {
-	return 2*i+2;
+	return 4*i+1;
 }
-static inline void xchg(heap_t* h, size_t i, size_t j)
+static inline void place(heap_t* h, size_t i, hnode_t n)
 {
-	hnode_t tmp = h->tree[i];
-	h->tree[i] = h->tree[j];
-	h->tree[j] = tmp;
+	h->tree[i] = n;
+	h->pos[n.id] = i;
 }
-static void bubbleUp(heap_t* h, size_t i)
+// move the hole at i up until n fits
+static size_t bubbleUp(heap_t* h, size_t i, hnode_t n)
 {
-	size_t p = parent(i);
-	while (h->tree[i].idx < h->tree[p].idx)
+	while (i > 0)
 	{
-		xchg(h, i, p);
+		size_t p = parent(i);
+		if (!(n.idx < h->tree[p].idx))
+			break;
+		place(h, i, h->tree[p]);
 		i = p;
-		p = parent(i);
 	}
+	place(h, i, n);
+	return i;
 }
-static void sinkDown(heap_t* h, size_t i)
+// move the hole at i down until n fits
+static void sinkDown(heap_t* h, size_t i, hnode_t n)
 {
 	while (1)
 	{
-		size_t l = left(i);
-		size_t r = right(i);
-
-		size_t next = i;
-		if (l < h->size && h->tree[l].idx < h->tree[next].idx)
-			next = l;
-		if (r < h->size && h->tree[r].idx < h->tree[next].idx)
-			next = r;
-
-		if (next != i)
-		{
-			xchg(h, i, next);
-			i = next;
-		}
-		else
+		size_t c = child(i);
+		if (c >= h->size)
+			break;
+
+		// smallest child
+		size_t end = c+4 < h->size ? c+4 : h->size;
+		size_t m = c;
+		for (size_t j = c+1; j < end; j++)
+			if (h->tree[j].idx < h->tree[m].idx)
+				m = j;
+
+		if (!(h->tree[m].idx < n.idx))
 			break;
+		place(h, i, h->tree[m]);
+		i = m;
 	}
+	place(h, i, n);
 }
 
-void heap_insert(heap_t* h, double idx, void* data)
+void heap_insert(heap_t* h, double idx, uint32_t id)
 {
 	if (h->size == h->avail)
 	{
-		h->avail = h->avail ? 2*h->avail : 1;
-		h->tree = (hnode_t*) realloc(h->tree, sizeof(hnode_t)*h->avail);
-		assert(h->tree != NULL);
+		h->avail = h->avail ? 2*h->avail : 64;
+		hnode_t* tree = alloc_tree(h->avail);
+		if (h->size != 0)
+			memcpy(tree, h->tree, h->size * sizeof(hnode_t));
+		free_tree(h->tree);
+		h->tree = tree;
+	}
+	if (id >= h->n_pos)
+	{
+		h->n_pos = 2*(size_t)id + 64;
+		h->pos = CREALLOC(h->pos, uint32_t, h->n_pos);
 	}
 
-	size_t i = h->size++;
-	h->tree[i] = (hnode_t){idx,data};
-	bubbleUp(h, i);
+	bubbleUp(h, h->size++, (hnode_t){idx,id});
+
+	if (h->size > h->peak)
+		h->peak = h->size;
 }
 
-void* heap_remove(heap_t* h)
+uint32_t heap_remove(heap_t* h)
 {
-	if (h->size == 0)
-		return NULL;
+	assert(h->size != 0);
+	uint32_t ret = h->tree[0].id;
+	heap_delete(h, ret);
+	return ret;
+}
 
-	void* ret = h->tree[0].data;
-	if (--h->size != 0)
-	{
-		xchg(h, 0, h->size);
-		sinkDown(h, 0);
-	}
+void heap_delete(heap_t* h, uint32_t id)
+{
+	size_t i = h->pos[id];
+	assert(i < h->size && h->tree[i].id == id);
 
-	if (h->size < h->avail/4)
-	{
-		h->avail /= 2;
-		h->tree = (hnode_t*) realloc(h->tree, sizeof(hnode_t)*h->avail);
-		assert(h->tree != NULL);
-	}
-	return ret;
+	// move last node in place of the removed one
+	hnode_t last = h->tree[--h->size];
+	if (i != h->size && bubbleUp(h, i, last) == i)
+		sinkDown(h, i, last);
+}
+
+void heap_update(heap_t* h, uint32_t id, double idx)
+{
+	size_t i = h->pos[id];
+	hnode_t n = {idx, id};
+	if (bubbleUp(h, i, n) == i)
+		sinkDown(h, i, n);
 }
@@ -23,11 +23,15 @@ typedef struct hnode hnode_t;
 typedef struct heap  heap_t;
 
 #include <sys/types.h>
+#include <stdint.h>
 
+// 4-ary min-heap of 32-bit ids; the tree is laid out so that the four
+// children of a node fit in one cache line, and the heap tracks the
+// position of each id so that any of them can be removed or re-keyed
 struct hnode
 {
-	double idx;
-	void* data;
+	double   idx;
+	uint32_t id;
 };
 
 struct heap
@@ -35,12 +39,23 @@ struct heap
 	size_t   size;
 	size_t   avail;
 	hnode_t* tree;
+
+	// position of each id in the tree
+	size_t    n_pos;
+	uint32_t* pos;
+
+	size_t peak; // largest size reached
 };
 
 void heap_init(heap_t* h);
 void heap_exit(heap_t* h);
+void heap_reset(heap_t* h); // empty the heap, keeping its arrays
+
+void     heap_insert(heap_t* h, double idx, uint32_t id);
+uint32_t heap_remove(heap_t* h); // the heap must not be empty
 
-void  heap_insert(heap_t* h, double idx, void* data);
-void* heap_remove(heap_t* h);
+// remove or re-key the node of a given id
+void heap_delete(heap_t* h, uint32_t id);
+void heap_update(heap_t* h, uint32_t id, double idx);
 
 #endif
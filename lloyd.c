@@ -19,8 +19,10 @@
 #include "lloyd.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#include "utils.h"
 #include "qsort_r.h"
 
 # define M_PI		3.14159265358979323846	/* pi */
@@ -57,8 +59,20 @@ static int poly_vert(const void* a, const void* b, void* arg)
 }
 void vr_region_points(point_t* dst, vr_region_t* r)
 {
-	// gather vertices (twice)
-	point_t tmp[2*r->n_edges];
+	// walk the boundary when it is closed
+	if (r->hedge != NULL)
+	{
+		vr_hedge_t* h = r->hedge;
+		do
+		{
+			*dst++ = *h->a;
+			h = h->next;
+		} while (h != r->hedge);
+		return;
+	}
+
+	// gather vertices (twice), dst is used as scratch space
+	point_t* tmp = dst;
 	for (size_t j = 0; j < r->n_edges; j++)
 	{
 		segment_t* s = &r->edges[j]->s;
@@ -84,33 +98,353 @@ void vr_region_points(point_t* dst, vr_region_t* r)
 		dst[j] = tmp[2*j];
 }
 
-void vr_lloyd_relaxation(vr_diagram_t* v)
+struct centroids
 {
-	vr_diagram_end(v);
+	vr_diagram_t* v;
+	point_t*      dst;
 
-	point_t npoints[v->n_regions];
-	size_t k = 0;
-	for (size_t i = 0; i < v->n_regions; i++)
+	// how far each site moved at the previous step (NULL if unknown)
+	const double* moved;
+	double        freeze;
+
+	// energy of each cell (NULL if not needed), kept for frozen cells
+	double* energy;
+
+	// one per thread, to gather the vertices of a cell
+	vr_scratch_t* scratch;
+};
+
+// the cell of r is left as is when neither its site nor those of its
+// neighbours moved more than 'freeze'
+static char frozen(struct centroids* c, vr_region_t* r)
+{
+	if (c->moved == NULL || c->freeze <= 0 || c->moved[r->id] > c->freeze)
+		return 0;
+	for (size_t j = 0; j < r->n_edges; j++)
+	{
+		vr_edge_t* e = r->edges[j];
+		vr_region_t* o = e->ra == r ? e->rb : e->ra;
+		if (o != NULL && c->moved[o->id] > c->freeze)
+			return 0;
+	}
+	return 1;
+}
+
+// centroids of regions a to b-1; the site is kept when the cell
+// is frozen, or when it has no valid centroid
+static void centroids(void* arg, size_t thread, size_t a, size_t b)
+{
+	struct centroids* c = (struct centroids*) arg;
+	vr_diagram_t* v = c->v;
+	for (size_t i = a; i < b; i++)
 	{
 		vr_region_t* r = v->regions[i];
+		c->dst[i] = r->p;
+		if (r->n_edges == 0)
+		{
+			if (c->energy != NULL)
+				c->energy[i] = 0;
+			continue;
+		}
+		if (frozen(c, r))
+			continue;
 
 		// gather vertices
-		point_t vertices[r->n_edges];
+		point_t* vertices = vr_scratch_reserve(&c->scratch[thread], 2*r->n_edges);
 		vr_region_points(vertices, r);
 
-		// compute centroid
-		point_t c = point_centroid(r->n_edges, vertices);
+		point_t p = point_centroid(r->n_edges, vertices);
+		if (0 <= p.x && p.x <= v->width && 0 <= p.y && p.y <= v->height)
+			c->dst[i] = p;
+		if (c->energy != NULL)
+			c->energy[i] = point_moment(r->n_edges, vertices, r->p);
+	}
+}
+
+// build the diagram and write the centroid of region i to dst[i];
+// return the energy of the diagram if 'energy' is not NULL
+static double lloyd_map(vr_diagram_t* v, threads_t* t, point_t* dst,
+	const double* moved, double freeze, double* energy)
+{
+	vr_diagram_end(v);
+
+	// each region has its own slot, so that the result does
+	// not depend on how the regions are split between threads
+	size_t n_threads = t != NULL ? t->n_threads : 1;
+	vr_scratch_t* scratch = vr_diagram_scratch(v, 1 + n_threads) + 1;
+	struct centroids arg = {v, dst, moved, freeze, energy, scratch};
+	if (t != NULL)
+		threads_run(t, v->n_regions, centroids, &arg);
+	else
+		centroids(&arg, 0, 0, v->n_regions);
 
-		if (0 <= c.x && c.x <= v->width && 0 <= c.y && c.y <= v->height)
+	double E = 0;
+	if (energy != NULL)
+		for (size_t i = 0; i < v->n_regions; i++)
+			E += energy[i];
+	return E;
+}
+
+void vr_lloyd_relaxation(vr_diagram_t* v, threads_t* t)
+{
+	// the first scratch array holds the new sites
+	size_t n = v->n_regions;
+	size_t n_threads = t != NULL ? t->n_threads : 1;
+	point_t* npoints = vr_scratch_reserve(vr_diagram_scratch(v, 1 + n_threads), n);
+	lloyd_map(v, t, npoints, NULL, 0, NULL);
+	vr_diagram_reset(v);
+	vr_diagram_points(v, n, npoints);
+}
+
+/*
+Lloyd's algorithm iterates x <- G(x), where G maps the sites to the
+centroids of their cells. Anderson acceleration keeps the last m
+differences of the residuals f = G(x) - x and of the images G(x), and
+takes the step
+	x <- G(x) - dG.gamma
+where gamma minimizes |f - dF.gamma|, so that the step extrapolates
+from the previous iterates instead of only following the last one.
+*/
+
+typedef struct anderson anderson_t;
+struct anderson
+{
+	size_t m;       // depth
+	size_t count;   // differences stored
+	size_t slot;    // where to store the next one
+	char   started; // whether f and g are set
+	size_t n;
+
+	point_t* f;  // last residual
+	point_t* g;  // last image
+	point_t* dF; // m arrays of n differences
+	point_t* dG;
+
+	double* A; // normal equations
+	double* b;
+};
+
+static void anderson_init(anderson_t* a, size_t m, size_t n)
+{
+	a->m       = m;
+	a->count   = 0;
+	a->slot    = 0;
+	a->started = 0;
+	a->n       = n;
+	a->f       = CALLOC(point_t, n);
+	a->g       = CALLOC(point_t, n);
+	a->dF      = CALLOC(point_t, m*n);
+	a->dG      = CALLOC(point_t, m*n);
+	a->A       = CALLOC(double, m*m);
+	a->b       = CALLOC(double, m);
+}
+
+// forget the previous steps
+static void anderson_restart(anderson_t* a)
+{
+	a->count   = 0;
+	a->slot    = 0;
+	a->started = 0;
+}
+
+static void anderson_exit(anderson_t* a)
+{
+	free(a->b);
+	free(a->A);
+	free(a->dG);
+	free(a->dF);
+	free(a->g);
+	free(a->f);
+}
+
+static double dot(size_t n, const point_t* u, const point_t* v)
+{
+	double ret = 0;
+	for (size_t i = 0; i < n; i++)
+		ret += u[i].x*v[i].x + u[i].y*v[i].y;
+	return ret;
+}
+
+// solve the k x k system A.x = b in place (x is put in b), return 0 if
+// it is singular
+static char solve(size_t k, double* A, double* b)
+{
+	for (size_t c = 0; c < k; c++)
+	{
+		// partial pivoting
+		size_t p = c;
+		for (size_t r = c+1; r < k; r++)
+			if (fabs(A[r*k+c]) > fabs(A[p*k+c]))
+				p = r;
+		if (A[p*k+c] == 0)
+			return 0;
+		if (p != c)
 		{
-			npoints[k].x = c.x;
-			npoints[k].y = c.y;
-			k++;
+			for (size_t j = 0; j < k; j++)
+			{
+				double t = A[c*k+j]; A[c*k+j] = A[p*k+j]; A[p*k+j] = t;
+			}
+			double t = b[c]; b[c] = b[p]; b[p] = t;
 		}
+
+		for (size_t r = c+1; r < k; r++)
+		{
+			double f = A[r*k+c] / A[c*k+c];
+			for (size_t j = c; j < k; j++)
+				A[r*k+j] -= f * A[c*k+j];
+			b[r] -= f * b[c];
+		}
+	}
+	for (size_t c = k; c-- > 0; )
+	{
+		for (size_t j = c+1; j < k; j++)
+			b[c] -= A[c*k+j] * b[j];
+		b[c] /= A[c*k+c];
+	}
+	return 1;
+}
+
+// given the sites x and their image g, write the next sites to x;
+// return 0 if they are the image (no extrapolation)
+static char anderson_step(anderson_t* a, point_t* x, const point_t* g)
+{
+	size_t n = a->n;
+	size_t m = a->m;
+
+	// residual, and differences with the previous step
+	point_t* dF = a->dF + a->slot*n;
+	point_t* dG = a->dG + a->slot*n;
+	for (size_t i = 0; i < n; i++)
+	{
+		point_t f = point_minus(g[i], x[i]);
+		if (a->started)
+		{
+			dF[i] = point_minus(f, a->f[i]);
+			dG[i] = point_minus(g[i], a->g[i]);
+		}
+		a->f[i] = f;
+		a->g[i] = g[i];
+	}
+	memcpy(x, g, n * sizeof(point_t));
+
+	// nothing to extrapolate from yet
+	if (!a->started)
+	{
+		a->started = 1;
+		return 0;
+	}
+	a->slot = (a->slot + 1) % m;
+	if (a->count < m)
+		a->count++;
+	size_t k = a->count;
+
+	// least squares by the normal equations, slightly regularized
+	double trace = 0;
+	for (size_t i = 0; i < k; i++)
+	{
+		for (size_t j = 0; j <= i; j++)
+		{
+			double d = dot(n, a->dF + i*n, a->dF + j*n);
+			a->A[i*k+j] = d;
+			a->A[j*k+i] = d;
+		}
+		a->b[i] = dot(n, a->dF + i*n, a->f);
+		trace += a->A[i*k+i];
 	}
-	double w = v->width;
-	double h = v->height;
-	vr_diagram_exit(v);
-	vr_diagram_init(v, w, h);
-	vr_diagram_points(v, k, npoints);
+	for (size_t i = 0; i < k; i++)
+		a->A[i*k+i] += 1e-10 * trace;
+
+	if (trace == 0 || !solve(k, a->A, a->b))
+		return 0;
+
+	for (size_t j = 0; j < k; j++)
+	{
+		const point_t* d = a->dG + j*n;
+		double c = a->b[j];
+		for (size_t i = 0; i < n; i++)
+		{
+			x[i].x -= c * d[i].x;
+			x[i].y -= c * d[i].y;
+		}
+	}
+	return 1;
+}
+
+size_t vr_lloyd_converge(vr_diagram_t* v, const vr_lloyd_t* l)
+{
+	size_t n = v->n_regions;
+	double*  moved  = CALLOC(double,  n);
+	double*  energy = CALLOC(double,  n);
+	point_t* x      = CALLOC(point_t, n);
+	point_t* g      = CALLOC(point_t, n);
+	for (size_t i = 0; i < n; i++)
+	{
+		moved[i] = HUGE_VAL;
+		x[i] = v->regions[i]->p;
+	}
+
+	anderson_t a;
+	anderson_init(&a, l->depth, l->depth != 0 ? n : 0);
+
+	double last = HUGE_VAL;
+	char accelerated = 0; // whether the last step was extrapolated
+	size_t k = 0;
+	while (k < l->max_iter)
+	{
+		double E = lloyd_map(v, l->threads, g, moved, l->freeze, energy);
+		k++;
+
+		// a plain Lloyd step never increases the energy; when an
+		// accelerated one did, it is undone: the sites go where a
+		// Lloyd step from the previous ones would have put them
+		point_t* next = g;
+		if (l->depth != 0)
+		{
+			if (accelerated && E > last)
+			{
+				memcpy(x, a.g, n * sizeof(point_t));
+				anderson_restart(&a);
+				accelerated = 0;
+			}
+			else
+			{
+				accelerated = anderson_step(&a, x, g);
+				last = E;
+			}
+			next = x;
+
+			// extrapolated sites may leave the box
+			for (size_t i = 0; i < n; i++)
+			{
+				next[i].x = fmin(fmax(next[i].x, 0), v->width);
+				next[i].y = fmin(fmax(next[i].y, 0), v->height);
+			}
+		}
+
+		double max = 0;
+		double sum = 0;
+		for (size_t i = 0; i < n; i++)
+		{
+			point_t d = point_minus(next[i], v->regions[i]->p);
+			moved[i] = sqrt(d.x*d.x + d.y*d.y);
+			if (moved[i] > max)
+				max = moved[i];
+			sum += moved[i];
+		}
+		if (l->report != NULL)
+			l->report(l->arg, k, max, n != 0 ? sum / n : 0, E);
+
+		vr_diagram_reset(v);
+		vr_diagram_points(v, n, next);
+
+		if (max <= l->tolerance)
+			break;
+	}
+
+	anderson_exit(&a);
+	free(g);
+	free(x);
+	free(energy);
+	free(moved);
+	return k;
 }
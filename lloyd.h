@@ -20,12 +20,45 @@
 #define LLOYD_H
 
 #include "voronoi.h"
+#include "threads.h"
 
-// returns the ordered points around a region
+// returns the ordered points around a region (counter-clockwise,
+// r->n_edges of them); dst must have room for 2*r->n_edges points
 void vr_region_points(point_t* dst, vr_region_t* r);
 
 // compute new 'vr_diagram_t' point set given
-// initial set using Lloyd relaxation
-void vr_lloyd_relaxation(vr_diagram_t* v);
+// initial set using Lloyd relaxation; the centroids
+// are computed by the threads of t (if not NULL)
+void vr_lloyd_relaxation(vr_diagram_t* v, threads_t* t);
+
+typedef struct vr_lloyd vr_lloyd_t;
+struct vr_lloyd
+{
+	double tolerance; // stop once no site moves more than this
+	size_t max_iter;
+
+	// cells whose site and neighbouring sites all moved less than
+	// this at the previous step are not relaxed (0 to relax all)
+	double freeze;
+
+	threads_t* threads; // may be NULL
+
+	// number of previous steps used by Anderson
+	// acceleration (0 for plain Lloyd iterations)
+	size_t depth;
+
+	// called after each step with the largest and mean
+	// displacement of the sites and the energy of the
+	// diagram they were moved from (may be NULL)
+	void (*report)(void* arg, size_t iter, double max, double mean, double energy);
+	void* arg;
+};
+
+// relax until convergence, return the number of steps done; site i
+// stays the site of region i (it is left in place when its cell has
+// no centroid in the diagram); the energy of a diagram is the sum over
+// the cells of the second moment of the cell about its site, which
+// centroidal diagrams minimize
+size_t vr_lloyd_converge(vr_diagram_t* v, const vr_lloyd_t* l);
 
 #endif
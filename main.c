@@ -16,17 +16,29 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 \*/
 
+#define _POSIX_C_SOURCE 199309L // clock_gettime()
+
 #include <GL/glut.h>
 #include <math.h>
 #include <string.h>
 #include <limits.h>
+#include <time.h>
 
 #include "utils.h"
 #include "voronoi.h"
 #include "lloyd.h"
+#include "flat.h"
+#include "parallel.h"
+#include "batch.h"
+#include "sitefile.h"
+#include "mask.h"
+
+# define M_PI		3.14159265358979323846	/* pi */
 
 int win_id;
 vr_diagram_t v;
+threads_t threads;
+char statsEnabled = 0;
 
 #define VR_WIDTH  800
 #define VR_HEIGHT 600
@@ -62,21 +74,21 @@ static void draw_parabola(point_t* f, double p, double y1, double y2)
 	glVertex2f(x, y2);
 }
 
-static void draw_beach(vr_bnode_t* n, double sweep, double miny, double maxy)
+static void draw_beach(double sweep)
 {
-	if (n == NULL)
-		return;
-
-	if (n->left != NULL)
+	double miny = 0;
+	for (vr_bnode_t* a = v.front.head; a != NULL; a = a->next)
 	{
-		point_t p;
-		parabola_intersect(&p, &n->r1->p, &n->r2->p, v.sweepline);
-
-		draw_beach(n->left,  sweep, miny, p.y);
-		draw_beach(n->right, sweep, p.y, maxy);
+		double maxy = VR_HEIGHT;
+		if (a->next != NULL)
+		{
+			point_t p;
+			parabola_intersect(&p, &a->rbreak->r1->p, &a->rbreak->r2->p, sweep);
+			maxy = p.y;
+		}
+		draw_parabola(&a->r1->p, sweep, miny, maxy);
+		miny = maxy;
 	}
-	else
-		draw_parabola(&n->r1->p, v.sweepline, miny, maxy);
 }
 static void cb_display(void)
 {
@@ -95,23 +107,19 @@ static void cb_display(void)
 	// beachline
 	glColor4ub(255, 0, 0, 255);
 	glBegin(GL_LINE_STRIP);
-	draw_beach(v.front.root, v.sweepline, 0, VR_HEIGHT);
+	draw_beach(v.sweepline);
 	glEnd();
 
 	// segments
 	glColor4ub(255, 255, 255, 255);
 	glBegin(GL_LINES);
-	for (size_t i = 0; i < v.n_regions; i++)
+	for (size_t i = 0; i < v.n_edges; i++)
 	{
-		vr_region_t* r = v.regions[i];
-		for (size_t j = 0; j < r->n_edges; j++)
-		{
-			segment_t* s = &r->edges[j]->s;
-			if (s->a == NULL || s->b == NULL)
-				continue;
-			glVertex2f(s->a->x, s->a->y);
-			glVertex2f(s->b->x, s->b->y);
-		}
+		segment_t* s = &v.edges[i]->s;
+		if (s->a == NULL || s->b == NULL)
+			continue;
+		glVertex2f(s->a->x, s->a->y);
+		glVertex2f(s->b->x, s->b->y);
 	}
 	glEnd();
 
@@ -125,6 +133,51 @@ static void cb_display(void)
 	glutSwapBuffers();
 }
 
+static void print_stats(void)
+{
+	vr_binbeach_t* b = &v.front;
+	fprintf(stderr, "beachline nodes: %zu allocations, %zu reused (%.1f%%), %zu slabs\n",
+		b->n_alloc, b->n_reused,
+		b->n_alloc ? 100. * b->n_reused / b->n_alloc : 0., b->n_slabs);
+	size_t false_alarms = v.n_cancelled + v.n_rescheduled;
+	fprintf(stderr, "event queue: %zu peak size, %zu circle events cancelled, %zu rescheduled, %zu skipped\n",
+		v.events.peak, v.n_cancelled, v.n_rescheduled, v.n_skipped);
+	fprintf(stderr, "vertices: %zu, %zu false alarms not materialized (%zu KiB)\n",
+		v.n_vertices, false_alarms,
+		false_alarms * (sizeof(vr_vertex_t) + sizeof(vr_vertex_t*)) / 1024);
+
+	size_t size =
+	v.n_vertices * (sizeof(vr_vertex_t) + sizeof(vr_vertex_t*))  +
+	v.n_edges    * (sizeof(vr_edge_t)   + 3*sizeof(vr_edge_t*))  +
+	v.n_regions  * (sizeof(vr_region_t) + sizeof(vr_region_t*)) +
+	0;
+	vr_flat_t f;
+	vr_flat_init(&f);
+	vr_flat_build(&f, &v);
+	size_t n_open = 0;
+	for (size_t i = 0; i < v.n_regions; i++)
+		n_open += v.regions[i]->n_edges != 0 && v.regions[i]->hedge == NULL;
+	fprintf(stderr, "output: %zu edges, %zu open cells, %zu KiB as pointers, %zu KiB flat\n",
+		v.n_edges, n_open, size / 1024, vr_flat_size(&f) / 1024);
+	vr_flat_exit(&f);
+}
+
+static void print_lloyd(void* arg, size_t iter, double max, double mean, double energy)
+{
+	(void) arg;
+	fprintf(stderr, "Lloyd step %zu: displacement max %g, mean %g, energy %.9g\n",
+		iter, max, mean, energy);
+}
+
+static void count_edge(void* arg, const point_t* a, const point_t* b, size_t ra, size_t rb)
+{
+	(void) a;
+	(void) b;
+	(void) ra;
+	(void) rb;
+	(*(size_t*) arg)++;
+}
+
 static void cb_keyboard(unsigned char c, int x, int y)
 {
 	(void) x;
@@ -133,17 +186,20 @@ static void cb_keyboard(unsigned char c, int x, int y)
 	if (c == 27)
 	{
 		glutDestroyWindow(win_id);
+		if (statsEnabled)
+			print_stats();
 		vr_diagram_exit(&v);
+		threads_exit(&threads);
 		exit(0);
 	}
 	else if (c == ' ')
 	{
 		v.sweepline += 1;
-		if (v.sweepline >= v.events.tree[0].idx)
+		if (v.sweepline >= vr_diagram_next(&v))
 			vr_diagram_step(&v);
 	}
 	else if (c == 'l')
-		vr_lloyd_relaxation(&v);
+		vr_lloyd_relaxation(&v, &threads);
 	else if (c == '\r')
 		vr_diagram_end(&v);
 	else if (c == 's')
@@ -161,6 +217,14 @@ static void cb_keyboard(unsigned char c, int x, int y)
 	glutPostRedisplay();
 }
 
+// elapsed time, unlike clock() which adds up the time of all threads
+static double wall_clock(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
 static void usage(const char* name)
 {
 	fprintf(stderr,
@@ -171,18 +235,284 @@ static void usage(const char* name)
 		"  -h, --help        print this help\n"
 		"  -V, --version     print version information\n"
 		"  -c, --nogui       disable the gui (benchmarking)\n"
-		, name
+		"  -s, --stats       print statistics on exit\n"
+		"  -i, --input DIST  site distribution: uniform (default), sorted, grid,\n"
+		"                    lattice, fan, cluster or line\n"
+		"  -l, --lloyd K     apply K steps of Lloyd relaxation first\n"
+		"  -e, --tolerance D stop the relaxation once no site moves more than D\n"
+		"  -f, --freeze D    do not relax cells whose neighbourhood moved less than D\n"
+		"  -a, --anderson M  accelerate the relaxation using the last M steps\n"
+		"  -t, --threads T   use T threads for Lloyd relaxation\n"
+		"                    (default: one per processor)\n"
+		"  -p, --parallel S  without gui, build the diagram by S slabs on the\n"
+		"                    threads (0: one per thread)\n"
+		"  -T, --tiles K     same, by tiles of about K sites (0: %d)\n"
+		"  -C, --compare     with -p or -T, compare the result with a single sweep\n"
+		"  -S, --stream      without gui, stream the edges instead of keeping them\n"
+		"  -B, --bounded     stop the sweep once it cannot change the box\n"
+		"  -D, --dump FILE   write the N sites to FILE (for vrsort) and exit\n"
+		"  -F, --file FILE   without gui, stream the diagram of the sites of\n"
+		"                    FILE, sorted by vrsort\n"
+		"  -b, --batch B     without gui, build B diagrams of N sites on the\n"
+		"                    threads and print the throughput\n"
+		"  -M, --mask K      without gui, restrict the cells to a demo mask of\n"
+		"                    K points, with holes (not when streaming)\n"
+		, name, VR_TILE_SITES
 	);
 	exit(1);
 }
 
+static double frand(void)
+{
+	return (double) rand() / INT_MAX;
+}
+
+// sorted: sites along the diagonal, arriving in increasing y order
+// grid:   a jittered grid, scanned column by column in y order
+// lattice: the same grid without jitter, whose columns share abscissas
+// fan:    a site near the bottom side and the others on a half circle
+//         around it, below the box, so that most of its cell is outside
+// cluster: dense clusters around a few centers, with sparse tails that
+//         reach far right of the box
+// line:   sites on a horizontal line, whose breakpoints never meet
+static char gen_points(point_t* dst, size_t n, const char* distribution)
+{
+	if (strcmp(distribution, "uniform") == 0)
+	{
+		for (size_t i = 0; i < n; i++)
+			dst[i] = (point_t){frand() * VR_WIDTH, frand() * VR_HEIGHT};
+	}
+	else if (strcmp(distribution, "sorted") == 0)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			double t = (i + frand()) / n;
+			dst[i] = (point_t){t * VR_WIDTH, t * VR_HEIGHT};
+		}
+	}
+	else if (strcmp(distribution, "grid") == 0)
+	{
+		size_t side = (size_t) ceil(sqrt(n));
+		double dx = (double) VR_WIDTH  / side;
+		double dy = (double) VR_HEIGHT / side;
+		for (size_t i = 0; i < n; i++)
+		{
+			size_t c = i / side;
+			size_t r = i % side;
+			double x = (c + .5) * dx + (r + frand()) * 1e-3 * dx / side;
+			double y = (r + .5) * dy + (frand() - .5) * 1e-3 * dy;
+			dst[i] = (point_t){x, y};
+		}
+	}
+	else if (strcmp(distribution, "lattice") == 0)
+	{
+		size_t side = (size_t) ceil(sqrt(n));
+		double dx = (double) VR_WIDTH  / side;
+		double dy = (double) VR_HEIGHT / side;
+		for (size_t i = 0; i < n; i++)
+			dst[i] = (point_t){(i / side + .5) * dx, (i % side + .5) * dy};
+	}
+	else if (strcmp(distribution, "fan") == 0)
+	{
+		point_t c = {VR_WIDTH / 2., VR_HEIGHT / 100.};
+		double r = VR_HEIGHT / 2.;
+		if (n != 0)
+			dst[0] = c;
+		for (size_t i = 1; i < n; i++)
+		{
+			double t = M_PI * (1 + (i - .5) / (n - 1));
+			dst[i] = (point_t){c.x + r * cos(t), c.y + r * sin(t)};
+		}
+	}
+	else if (strcmp(distribution, "line") == 0)
+	{
+		for (size_t i = 0; i < n; i++)
+			dst[i] = (point_t){VR_WIDTH * (1 + 6. * i / n) / 8, VR_HEIGHT / 2.};
+	}
+	else if (strcmp(distribution, "cluster") == 0)
+	{
+		point_t centers[8];
+		for (size_t i = 0; i < 8; i++)
+			centers[i] = (point_t){frand() * VR_WIDTH, frand() * VR_HEIGHT};
+		for (size_t i = 0; i < n; i++)
+		{
+			// most sites within a few pixels of their center, the
+			// others up to a few box widths away
+			point_t c = centers[i % 8];
+			double t = 2 * M_PI * frand();
+			double s = 1.01 - frand();
+			double r = 5 / (s * s);
+			dst[i] = (point_t){c.x + fabs(r * cos(t)), c.y + r * sin(t) / 8};
+		}
+	}
+	else
+		return 0;
+	return 1;
+}
+
+// build n_batch diagrams of n sites, twice, and time the second run,
+// once the diagrams of the threads have grown to their size
+static int batch(const char* name, size_t n_batch, size_t n, const char* distribution)
+{
+	srand(42);
+	point_t* points = CALLOC(point_t, n_batch * n);
+	vr_job_t* jobs = CALLOC(vr_job_t, n_batch);
+	vr_flat_t* out = CALLOC(vr_flat_t, n_batch);
+	for (size_t i = 0; i < n_batch; i++)
+	{
+		if (!gen_points(points + i*n, n, distribution))
+		{
+			free(out);
+			free(jobs);
+			free(points);
+			usage(name);
+		}
+		jobs[i] = (vr_job_t){VR_WIDTH, VR_HEIGHT, n, points + i*n};
+		vr_flat_init(&out[i]);
+	}
+
+	vr_batch_t b;
+	vr_batch_init(&b, &threads);
+	vr_batch_run(&b, n_batch, jobs, out);
+	double start = wall_clock();
+	vr_batch_run(&b, n_batch, jobs, out);
+	double t = wall_clock() - start;
+	vr_batch_exit(&b);
+
+	size_t n_edges = 0;
+	for (size_t i = 0; i < n_batch; i++)
+	{
+		n_edges += out[i].n_edges;
+		vr_flat_exit(&out[i]);
+	}
+	fprintf(stderr, "%zu diagrams of %zu sites in %.3fs on %zu threads: %.0f diagrams per second (%zu edges)\n",
+		n_batch, n, t, threads.n_threads, n_batch / t, n_edges);
+
+	free(out);
+	free(jobs);
+	free(points);
+	threads_exit(&threads);
+	return 0;
+}
+
+// a wobbly disc with a hole, with an island in it, and a bay cut by
+// the left side of the box, with k points in all
+static void demo_mask(vr_mask_t* m, size_t k)
+{
+	struct { double x, y, r, wobble, share; char hole; } rings[4] =
+	{
+		{.50 * VR_WIDTH, .50 * VR_HEIGHT, .46 * VR_HEIGHT, .2, .5,   0},
+		{.50 * VR_WIDTH, .50 * VR_HEIGHT, .20 * VR_HEIGHT, .1, .25,  1},
+		{.50 * VR_WIDTH, .50 * VR_HEIGHT, .08 * VR_HEIGHT,  0, .125, 0},
+		{-.06 * VR_WIDTH, .50 * VR_HEIGHT, .16 * VR_HEIGHT, 0, .125, 0},
+	};
+	point_t* p = CALLOC(point_t, k);
+	for (int i = 0; i < 4; i++)
+	{
+		size_t n = (size_t) (rings[i].share * k);
+		for (size_t j = 0; j < n; j++)
+		{
+			double t = 2 * M_PI * j / n;
+			double r = rings[i].r * (1 + rings[i].wobble * sin(7 * t));
+			p[j] = (point_t){rings[i].x + r * cos(t), rings[i].y + r * sin(t)};
+		}
+		vr_mask_ring(m, n, p, rings[i].hole);
+	}
+	free(p);
+}
+
+static int dump_sites(const char* prog, const char* name, size_t n, const char* distribution)
+{
+	FILE* f = fopen(name, "wb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Could not open '%s'\n", name);
+		return 1;
+	}
+
+	// uniform sites by pieces, to dump more than fit in memory (the
+	// other distributions depend on the total)
+	size_t piece = strcmp(distribution, "uniform") == 0 && n > 4096 ? 4096 : n;
+	point_t* points = CALLOC(point_t, piece);
+	srand(42);
+	for (size_t i = 0; i < n; i += piece)
+	{
+		size_t k = n - i < piece ? n - i : piece;
+		if (!gen_points(points, k, distribution))
+		{
+			free(points);
+			fclose(f);
+			usage(prog);
+		}
+		if (fwrite(points, sizeof(point_t), k, f) != k)
+			break;
+	}
+	free(points);
+
+	char failed = ferror(f) != 0;
+	if (fclose(f) != 0 || failed)
+	{
+		fprintf(stderr, "Could not write sites to '%s'\n", name);
+		return 1;
+	}
+	threads_exit(&threads);
+	return 0;
+}
+
+// stream the diagram of the sites of a sorted file, without keeping
+// the sites nor the edges
+static int sweep_file(const char* name)
+{
+	FILE* f = fopen(name, "rb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Could not open '%s'\n", name);
+		return 1;
+	}
+
+	size_t n_streamed = 0;
+	vr_diagram_init(&v, VR_WIDTH, VR_HEIGHT, 0);
+	vr_diagram_source(&v, vr_sitefile_read, f);
+	vr_diagram_stream(&v, count_edge, &n_streamed);
+
+	double start = wall_clock();
+	char ok = vr_diagram_end(&v);
+	double t = wall_clock() - start;
+	if (!ok)
+		fprintf(stderr, "Sites are not sorted by abscissa\n");
+	else if (statsEnabled)
+		fprintf(stderr, "%zu sites in %.3fs, %zu edges streamed, at most %zu regions, %zu edges and %zu vertices held\n",
+			v.n_given, t, n_streamed, v.a_regions, v.a_edges, v.a_vertices);
+
+	vr_diagram_exit(&v);
+	fclose(f);
+	threads_exit(&threads);
+	return !ok;
+}
+
 int main(int argc, char** argv)
 {
 	char glEnabled = 1;
 	size_t n_points = 100;
+	const char* distribution = "uniform";
+	size_t n_lloyd = 0;
+	size_t n_threads = 0;
+	double tolerance = 0;
+	double freeze = 0;
+	size_t anderson = 0;
+	char parallel = 0; // 1 for slabs, 2 for tiles
+	size_t n_slabs = 0;
+	size_t tile_sites = 0;
+	char compare = 0;
+	size_t n_batch = 0;
+	size_t n_mask = 0;
+	char stream = 0;
+	char bounded = 0;
+	const char* dump = NULL;
+	const char* file = NULL;
 
 	int curarg = 1;
-	if (curarg < argc)
+	while (curarg < argc)
 	{
 		const char* option = argv[curarg++];
 		if (strcmp(option, "--help") == 0 || strcmp(option, "-h") == 0)
@@ -199,20 +529,138 @@ int main(int argc, char** argv)
 		{
 			glEnabled = 0;
 		}
+		else if (strcmp(option, "--stats") == 0 || strcmp(option, "-s") == 0)
+		{
+			statsEnabled = 1;
+		}
+		else if (strcmp(option, "--input") == 0 || strcmp(option, "-i") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			distribution = argv[curarg++];
+		}
+		else if (strcmp(option, "--lloyd") == 0 || strcmp(option, "-l") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			n_lloyd = atoi(argv[curarg++]);
+		}
+		else if (strcmp(option, "--tolerance") == 0 || strcmp(option, "-e") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			tolerance = atof(argv[curarg++]);
+		}
+		else if (strcmp(option, "--freeze") == 0 || strcmp(option, "-f") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			freeze = atof(argv[curarg++]);
+		}
+		else if (strcmp(option, "--anderson") == 0 || strcmp(option, "-a") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			anderson = atoi(argv[curarg++]);
+		}
+		else if (strcmp(option, "--threads") == 0 || strcmp(option, "-t") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			n_threads = atoi(argv[curarg++]);
+		}
+		else if (strcmp(option, "--parallel") == 0 || strcmp(option, "-p") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			parallel = 1;
+			n_slabs = atoi(argv[curarg++]);
+		}
+		else if (strcmp(option, "--tiles") == 0 || strcmp(option, "-T") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			parallel = 2;
+			tile_sites = atoi(argv[curarg++]);
+		}
+		else if (strcmp(option, "--compare") == 0 || strcmp(option, "-C") == 0)
+		{
+			compare = 1;
+		}
+		else if (strcmp(option, "--stream") == 0 || strcmp(option, "-S") == 0)
+		{
+			stream = 1;
+		}
+		else if (strcmp(option, "--bounded") == 0 || strcmp(option, "-B") == 0)
+		{
+			bounded = 1;
+		}
+		else if (strcmp(option, "--dump") == 0 || strcmp(option, "-D") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			dump = argv[curarg++];
+		}
+		else if (strcmp(option, "--file") == 0 || strcmp(option, "-F") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			file = argv[curarg++];
+		}
+		else if (strcmp(option, "--batch") == 0 || strcmp(option, "-b") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			n_batch = atoi(argv[curarg++]);
+		}
+		else if (strcmp(option, "--mask") == 0 || strcmp(option, "-M") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			n_mask = atoi(argv[curarg++]);
+		}
 		else
+		{
 			curarg--;
+			break;
+		}
 	}
 	if (curarg < argc)
 		n_points = atoi(argv[curarg++]);
+	// the cells are not kept when streaming
+	if (n_mask != 0 && (stream || file != NULL))
+		usage(argv[0]);
+
+	threads_init(&threads, n_threads);
+	if (n_batch != 0)
+		return batch(argv[0], n_batch, n_points, distribution);
+	if (dump != NULL)
+		return dump_sites(argv[0], dump, n_points, distribution);
+	if (file != NULL)
+		return sweep_file(file);
 
-	vr_diagram_init(&v, VR_WIDTH, VR_HEIGHT);
+	// edges and vertices are not kept when streaming
+	vr_diagram_init(&v, VR_WIDTH, VR_HEIGHT, stream ? 0 : n_points);
 
 	srand(42);
-	for (size_t i = 0; i < n_points; i++)
+	point_t* points = CALLOC(point_t, n_points);
+	if (!gen_points(points, n_points, distribution))
+		usage(argv[0]);
+	vr_diagram_points(&v, n_points, points);
+	vr_diagram_bounded(&v, bounded);
+	free(points);
+
+	if (n_lloyd != 0)
 	{
-		double x = ( (double) rand() / INT_MAX ) * VR_WIDTH;
-		double y = ( (double) rand() / INT_MAX ) * VR_HEIGHT;
-		vr_diagram_point(&v, (point_t){x,y});
+		vr_lloyd_t l = {tolerance, n_lloyd, freeze, &threads, anderson, statsEnabled ? print_lloyd : NULL, NULL};
+		clock_t start = clock();
+		n_lloyd = vr_lloyd_converge(&v, &l);
+		if (statsEnabled)
+		{
+			double t = (double) (clock() - start) / CLOCKS_PER_SEC;
+			fprintf(stderr, "%zu Lloyd steps in %.3fs (%.3fs per step)\n",
+				n_lloyd, t, t / n_lloyd);
+		}
 	}
 
 	if (glEnabled)
@@ -226,10 +674,81 @@ int main(int argc, char** argv)
 		glInit();
 		glutMainLoop();
 	}
+	else if (parallel)
+	{
+		// from the relaxed sites, if any
+		point_t* sites = CALLOC(point_t, v.n_regions);
+		for (size_t i = 0; i < v.n_regions; i++)
+			sites[i] = v.regions[i]->p;
+
+		vr_flat_t f;
+		vr_flat_init(&f);
+		double start = wall_clock();
+		size_t n_sweeps = parallel == 1 ?
+			vr_parallel_slabs(&f, VR_WIDTH, VR_HEIGHT, v.n_regions, sites, &threads, n_slabs) :
+			vr_parallel_tiles(&f, VR_WIDTH, VR_HEIGHT, v.n_regions, sites, &threads, tile_sites);
+		double t = wall_clock() - start;
+		if (statsEnabled)
+			fprintf(stderr, "%zu sites in %.3fs on %zu threads (%zu sweeps), %zu edges\n",
+				v.n_regions, t, threads.n_threads, n_sweeps, (size_t) f.n_edges);
+		if (compare)
+		{
+			vr_flat_t g;
+			vr_flat_init(&g);
+			vr_diagram_reset(&v);
+			vr_diagram_points(&v, f.n_regions, sites);
+			vr_diagram_end(&v);
+			vr_flat_build(&g, &v);
+			fprintf(stderr, "%zu edges differ from a single sweep\n", vr_flat_diff(&f, &g));
+			vr_flat_exit(&g);
+		}
+		vr_flat_exit(&f);
+		free(sites);
+		vr_diagram_exit(&v);
+		threads_exit(&threads);
+		return 0;
+	}
 	else
 	{
+		size_t n_streamed = 0;
+		if (stream)
+			vr_diagram_stream(&v, count_edge, &n_streamed);
+
+		clock_t start = clock();
+		while (vr_diagram_step(&v));
+		clock_t swept = clock();
 		vr_diagram_end(&v);
+		if (statsEnabled)
+		{
+			double t = (double) (clock() - start) / CLOCKS_PER_SEC;
+			double s = (double) (swept  - start) / CLOCKS_PER_SEC;
+			fprintf(stderr, "%zu sites in %.3fs (%.1f ns per site log site), sweep %.3fs, end %.3fs (%.1f ns per site)\n",
+				n_points, t, n_points > 1 ? 1e9 * t / (n_points * log2(n_points)) : 0., s,
+				t - s, n_points ? 1e9 * (t - s) / n_points : 0.);
+			if (stream)
+				fprintf(stderr, "%zu edges streamed, at most %zu edges and %zu vertices held, %zu events skipped\n",
+					n_streamed, v.a_edges, v.a_vertices, v.n_skipped);
+			else
+				print_stats();
+		}
+		if (n_mask != 0)
+		{
+			vr_mask_t m;
+			vr_masked_t c;
+			vr_mask_init(&m);
+			vr_masked_init(&c);
+			demo_mask(&m, n_mask);
+			clock_t start = clock();
+			vr_mask_clip(&m, &c, &v);
+			double t = (double) (clock() - start) / CLOCKS_PER_SEC;
+			if (statsEnabled)
+				fprintf(stderr, "mask of %zu points in %.3fs: %zu cells inside, %zu outside, %zu clipped, %zu open, %zu rings\n",
+					m.n_points, t, m.n_inside, m.n_outside, m.n_clipped, m.n_open, c.n_rings);
+			vr_masked_exit(&c);
+			vr_mask_exit(&m);
+		}
 		vr_diagram_exit(&v);
+		threads_exit(&threads);
 		return 0;
 	}
 }
@@ -0,0 +1,609 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "mask.h"
+
+#include <string.h>
+#include <math.h>
+
+#include "utils.h"
+
+void vr_mask_init(vr_mask_t* m)
+{
+	m->n_points = 0;
+	m->a_points = 0;
+	m->points   = NULL;
+	m->next     = NULL;
+
+	m->n_cells    = 0;
+	m->nx         = 0;
+	m->ny         = 0;
+	m->x0         = 0;
+	m->y0         = 0;
+	m->cw         = 0;
+	m->ch         = 0;
+	m->cell_start = NULL;
+	m->cell_segs  = NULL;
+	m->cell_state = NULL;
+
+	m->a_cell    = 0;
+	m->cell      = NULL;
+	m->a_pieces  = 0;
+	m->pieces    = NULL;
+	m->piece_of  = NULL;
+	m->seen      = NULL;
+	m->stamp     = 0;
+	m->a_entries = 0;
+	m->entries   = NULL;
+
+	m->n_inside  = 0;
+	m->n_outside = 0;
+	m->n_clipped = 0;
+	m->n_open    = 0;
+}
+
+void vr_mask_exit(vr_mask_t* m)
+{
+	free(m->points);
+	free(m->next);
+	free(m->cell_start);
+	free(m->cell_segs);
+	free(m->cell_state);
+	free(m->cell);
+	free(m->pieces);
+	free(m->piece_of);
+	free(m->seen);
+	free(m->entries);
+}
+
+void vr_mask_ring(vr_mask_t* m, size_t n, const point_t* p, char hole)
+{
+	if (n < 3)
+		return;
+
+	if (m->n_points + n > m->a_points)
+	{
+		m->a_points = m->n_points + n > 2*m->a_points ? m->n_points + n : 2*m->a_points;
+		m->points = CREALLOC(m->points, point_t, m->a_points);
+		m->next   = CREALLOC(m->next,   size_t,  m->a_points);
+	}
+
+	// the sign of the area gives the orientation
+	double area = 0;
+	for (size_t i = 0; i < n; i++)
+		area += point_cross(p[i], p[(i+1) % n]);
+	char reverse = hole ? area > 0 : area < 0;
+
+	size_t first = m->n_points;
+	for (size_t i = 0; i < n; i++)
+	{
+		m->points[first + i] = p[reverse ? n-1 - i : i];
+		m->next  [first + i] = i+1 < n ? first + i+1 : first;
+	}
+	m->n_points += n;
+	m->n_cells = 0;
+}
+
+static size_t cell_x(vr_mask_t* m, double x)
+{
+	double c = floor((x - m->x0) / m->cw);
+	return c < 0 ? 0 : c >= m->nx ? m->nx - 1 : (size_t) c;
+}
+static size_t cell_y(vr_mask_t* m, double y)
+{
+	double c = floor((y - m->y0) / m->ch);
+	return c < 0 ? 0 : c >= m->ny ? m->ny - 1 : (size_t) c;
+}
+
+// count (fill = 0) or fill the grid cells crossed by segment s, row by
+// row; the range of each row is widened a little so that a crossing
+// computed by crossings() is always found in one of them
+static void register_segment(vr_mask_t* m, size_t s, char fill)
+{
+	point_t a = m->points[s];
+	point_t b = m->points[m->next[s]];
+	if (a.y > b.y)
+	{
+		point_t t = a;
+		a = b;
+		b = t;
+	}
+	double eps = 1e-9 * m->cw;
+
+	size_t y1 = cell_y(m, b.y);
+	for (size_t cy = cell_y(m, a.y); cy <= y1; cy++)
+	{
+		double lo = fmax(a.y, m->y0 +  cy    * m->ch);
+		double hi = fmin(b.y, m->y0 + (cy+1) * m->ch);
+		double xl = a.x;
+		double xh = b.x;
+		if (b.y != a.y)
+		{
+			xl = a.x + (lo - a.y) / (b.y - a.y) * (b.x - a.x);
+			xh = a.x + (hi - a.y) / (b.y - a.y) * (b.x - a.x);
+		}
+		if (xl > xh)
+		{
+			double t = xl;
+			xl = xh;
+			xh = t;
+		}
+
+		size_t x1 = cell_x(m, xh + eps);
+		for (size_t cx = cell_x(m, xl - eps); cx <= x1; cx++)
+		{
+			size_t c = cy * m->nx + cx;
+			if (fill)
+				m->cell_segs[m->cell_start[c]++] = s;
+			else
+				m->cell_start[c+1]++;
+		}
+	}
+}
+
+// crossings of line y by the segments of cell c in column cx, each
+// counted in the one column where it falls; those right of x are
+// counted in *right
+static size_t crossings(vr_mask_t* m, size_t c, size_t cx, double y, double x, size_t* right)
+{
+	size_t n = 0;
+	*right = 0;
+	for (size_t i = m->cell_start[c]; i < m->cell_start[c+1]; i++)
+	{
+		size_t s = m->cell_segs[i];
+		point_t a = m->points[s];
+		point_t b = m->points[m->next[s]];
+		if ((a.y > y) == (b.y > y))
+			continue;
+
+		double xc = a.x + (y - a.y) / (b.y - a.y) * (b.x - a.x);
+		if (cell_x(m, xc) != cx)
+			continue;
+		n++;
+		if (xc > x)
+			(*right)++;
+	}
+	return n;
+}
+
+void vr_mask_index(vr_mask_t* m, size_t n_cells)
+{
+	m->n_cells = n_cells;
+	if (m->n_points == 0)
+	{
+		m->nx = 0;
+		m->ny = 0;
+		return;
+	}
+
+	double x0 = HUGE_VAL, x1 = -HUGE_VAL;
+	double y0 = HUGE_VAL, y1 = -HUGE_VAL;
+	for (size_t i = 0; i < m->n_points; i++)
+	{
+		point_t p = m->points[i];
+		x0 = fmin(x0, p.x);
+		x1 = fmax(x1, p.x);
+		y0 = fmin(y0, p.y);
+		y1 = fmax(y1, p.y);
+	}
+	double w = x1 > x0 ? x1 - x0 : 1;
+	double h = y1 > y0 ? y1 - y0 : 1;
+
+	// square cells
+	double side = sqrt(w * h / (n_cells != 0 ? n_cells : 1));
+	m->nx = (size_t) fmax(1, ceil(w / side));
+	m->ny = (size_t) fmax(1, ceil(h / side));
+	m->x0 = x0;
+	m->y0 = y0;
+	m->cw = w / m->nx;
+	m->ch = h / m->ny;
+
+	// count, compute offsets, fill (which shifts the offsets)
+	size_t n = m->nx * m->ny;
+	m->cell_start = CREALLOC(m->cell_start, size_t, n + 1);
+	m->cell_state = CREALLOC(m->cell_state, char,   n);
+	memset(m->cell_start, 0, (n + 1) * sizeof(size_t));
+	for (size_t s = 0; s < m->n_points; s++)
+		register_segment(m, s, 0);
+	for (size_t c = 0; c < n; c++)
+		m->cell_start[c+1] += m->cell_start[c];
+	m->cell_segs = CREALLOC(m->cell_segs, size_t, m->cell_start[n] + 1);
+	for (size_t s = 0; s < m->n_points; s++)
+		register_segment(m, s, 1);
+	for (size_t c = n; c > 0; c--)
+		m->cell_start[c] = m->cell_start[c-1];
+	m->cell_start[0] = 0;
+
+	// an empty cell is inside when a ray from its center to the right
+	// crosses the boundary an odd number of times
+	for (size_t cy = 0; cy < m->ny; cy++)
+	{
+		double y = m->y0 + (cy + .5) * m->ch;
+		size_t count = 0;
+		for (size_t cx = m->nx; cx-- > 0; )
+		{
+			size_t c = cy * m->nx + cx;
+			size_t right;
+			size_t k = crossings(m, c, cx, y, m->x0 + (cx + .5) * m->cw, &right);
+			m->cell_state[c] =
+				m->cell_start[c] != m->cell_start[c+1] ? VR_MASK_CROSSED :
+				(count + right) % 2 ? VR_MASK_IN : VR_MASK_OUT;
+			count += k;
+		}
+	}
+
+	m->piece_of = CREALLOC(m->piece_of, size_t, m->n_points);
+	m->seen     = CREALLOC(m->seen,     size_t, m->n_points);
+	for (size_t s = 0; s < m->n_points; s++)
+	{
+		m->piece_of[s] = VR_NONE;
+		m->seen[s]     = 0;
+	}
+}
+
+static char in_grid(vr_mask_t* m, double x, double y)
+{
+	return
+	m->nx != 0 &&
+	m->x0 <= x && x <= m->x0 + m->nx * m->cw &&
+	m->y0 <= y && y <= m->y0 + m->ny * m->ch &&
+	1;
+}
+
+char vr_mask_inside(vr_mask_t* m, point_t p)
+{
+	if (m->n_cells == 0)
+		vr_mask_index(m, m->n_points);
+	if (!in_grid(m, p.x, p.y))
+		return 0;
+
+	// parity of the crossings of a ray to the right, up to the first
+	// empty cell, whose flag gives the parity of the rest
+	size_t cy = cell_y(m, p.y);
+	size_t count = 0;
+	for (size_t cx = cell_x(m, p.x); cx < m->nx; cx++)
+	{
+		size_t c = cy * m->nx + cx;
+		if (m->cell_state[c] != VR_MASK_CROSSED)
+			return (count + m->cell_state[c]) % 2;
+		size_t right;
+		crossings(m, c, cx, p.y, p.x, &right);
+		count += right;
+	}
+	return count % 2;
+}
+
+void vr_masked_init(vr_masked_t* c)
+{
+	*c = (vr_masked_t){0, NULL, NULL, 0, 0, NULL, 0, 0, NULL};
+}
+
+void vr_masked_exit(vr_masked_t* c)
+{
+	free(c->region_start);
+	free(c->region_end);
+	free(c->ring_start);
+	free(c->points);
+}
+
+static void new_ring(vr_masked_t* c)
+{
+	if (c->n_rings + 2 > c->a_rings)
+	{
+		c->a_rings = c->a_rings == 0 ? 64 : 2*c->a_rings;
+		c->ring_start = CREALLOC(c->ring_start, size_t, c->a_rings);
+	}
+	c->ring_start[c->n_rings++] = c->n_points;
+}
+// drop the last ring if it is degenerate
+static void end_ring(vr_masked_t* c)
+{
+	if (c->n_points - c->ring_start[c->n_rings-1] < 3)
+		c->n_points = c->ring_start[--c->n_rings];
+}
+static void push_point(vr_masked_t* c, point_t p)
+{
+	if (c->n_points == c->a_points)
+	{
+		c->a_points = c->a_points == 0 ? 256 : 2*c->a_points;
+		c->points = CREALLOC(c->points, point_t, c->a_points);
+	}
+	c->points[c->n_points++] = p;
+}
+
+// position of p along the boundary of the cell, on its side j
+static double position(vr_mask_t* m, size_t k, size_t j, point_t p)
+{
+	point_t a = m->cell[j];
+	point_t e = point_minus(m->cell[(j+1) % k], a);
+	double u = point_dot(point_minus(p, a), e) / point_dot(e, e);
+	double pos = j + fmin(fmax(u, 0), 1);
+	return pos < k ? pos : pos - k;
+}
+
+// clip segment s to the convex cell of k sides (Cyrus-Beck), and add
+// the piece left, if any, as the n-th one
+static size_t clip_segment(vr_mask_t* m, size_t k, size_t s, size_t n)
+{
+	point_t a = m->points[s];
+	point_t d = point_minus(m->points[m->next[s]], a);
+
+	// a + t d is inside side j when num + t den >= 0
+	double t0 = 0;
+	double t1 = 1;
+	size_t j0 = VR_NONE;
+	size_t j1 = VR_NONE;
+	for (size_t j = 0; j < k; j++)
+	{
+		point_t e = point_minus(m->cell[(j+1) % k], m->cell[j]);
+		double num = point_cross(e, point_minus(a, m->cell[j]));
+		double den = point_cross(e, d);
+		if (den == 0)
+		{
+			if (num < 0)
+				return n;
+			continue;
+		}
+		double t = -num / den;
+		if (den > 0 && t > t0)
+		{
+			t0 = t;
+			j0 = j;
+		}
+		else if (den < 0 && t < t1)
+		{
+			t1 = t;
+			j1 = j;
+		}
+	}
+	if (!(t0 < t1))
+		return n;
+
+	if (n == m->a_pieces)
+	{
+		m->a_pieces = m->a_pieces == 0 ? 64 : 2*m->a_pieces;
+		m->pieces  = CREALLOC(m->pieces,  vr_mask_piece_t,  m->a_pieces);
+		m->entries = CREALLOC(m->entries, vr_mask_piece_t*, m->a_pieces);
+	}
+	vr_mask_piece_t* p = &m->pieces[n];
+	p->seg  = s;
+	p->a    = j0 == VR_NONE ? a : (point_t){a.x + t0*d.x, a.y + t0*d.y};
+	p->b    = j1 == VR_NONE ? m->points[m->next[s]] : (point_t){a.x + t1*d.x, a.y + t1*d.y};
+	p->in   = j0 == VR_NONE ? -1 : position(m, k, j0, p->a);
+	p->out  = j1 == VR_NONE ? -1 : position(m, k, j1, p->b);
+	p->done = 0;
+	m->piece_of[s] = n;
+	return n + 1;
+}
+
+static int cmp_entry(const void* a, const void* b)
+{
+	double pa = (*(vr_mask_piece_t* const*) a)->in;
+	double pb = (*(vr_mask_piece_t* const*) b)->in;
+	return (pa > pb) - (pa < pb);
+}
+
+// the first piece entering the cell after position x along its
+// boundary, going around; NULL when none does
+static vr_mask_piece_t* next_entry(vr_mask_t* m, size_t n, double x)
+{
+	if (n == 0)
+		return NULL;
+	size_t lo = 0;
+	size_t hi = n;
+	while (lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		if (m->entries[mid]->in > x)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return m->entries[lo < n ? lo : 0];
+}
+
+// follow the pieces from p0 into a ring: a piece ending inside the cell
+// is followed by that of the next segment; one leaving it, by the
+// boundary of the cell (which is inside the mask from there) up to the
+// next piece entering it
+static void follow(vr_mask_t* m, vr_masked_t* c, size_t k, size_t n_entries, vr_mask_piece_t* p0)
+{
+	new_ring(c);
+	vr_mask_piece_t* p = p0;
+	do
+	{
+		p->done = 1;
+		push_point(c, p->a);
+		if (p->out >= 0)
+		{
+			push_point(c, p->b);
+			vr_mask_piece_t* q = next_entry(m, n_entries, p->out);
+			if (q == NULL) // degenerate
+				break;
+			double end = q->in > p->out ? q->in : q->in + k;
+			for (double x = floor(p->out) + 1; x < end; x++)
+				push_point(c, m->cell[(size_t) x % k]);
+			p = q;
+		}
+		else
+		{
+			size_t i = m->piece_of[m->next[p->seg]];
+			if (i == VR_NONE) // degenerate
+				break;
+			p = &m->pieces[i];
+		}
+	} while (!p->done);
+	end_ring(c);
+}
+
+static void clip_region(vr_mask_t* m, vr_masked_t* c, vr_region_t* r)
+{
+	// a cell with no edges is empty (outside of the box); one whose
+	// boundary could not be closed cannot be clipped, and is counted
+	// apart instead of being silently dropped
+	if (r->hedge == NULL)
+	{
+		if (r->n_edges == 0)
+			m->n_outside++;
+		else
+			m->n_open++;
+		return;
+	}
+
+	// boundary and bounding box of the cell
+	size_t k = 0;
+	double x0 = HUGE_VAL, x1 = -HUGE_VAL;
+	double y0 = HUGE_VAL, y1 = -HUGE_VAL;
+	vr_hedge_t* h = r->hedge;
+	do
+	{
+		if (k == m->a_cell)
+		{
+			m->a_cell = m->a_cell == 0 ? 16 : 2*m->a_cell;
+			m->cell = CREALLOC(m->cell, point_t, m->a_cell);
+		}
+		// (fmin() and fmax() are calls, which are slow here)
+		point_t p = *h->a;
+		m->cell[k++] = p;
+		x0 = p.x < x0 ? p.x : x0;
+		x1 = p.x > x1 ? p.x : x1;
+		y0 = p.y < y0 ? p.y : y0;
+		y1 = p.y > y1 ? p.y : y1;
+		h = h->next;
+	} while (h != r->hedge);
+
+	if (m->nx == 0 ||
+	    x1 < m->x0 || x0 > m->x0 + m->nx * m->cw ||
+	    y1 < m->y0 || y0 > m->y0 + m->ny * m->ch)
+	{
+		m->n_outside++;
+		return;
+	}
+
+	// a cell covering only empty grid cells is entirely inside or
+	// outside (those on the side of the grid are outside)
+	size_t cx0 = cell_x(m, x0), cx1 = cell_x(m, x1);
+	size_t cy0 = cell_y(m, y0), cy1 = cell_y(m, y1);
+	char crossed = 0;
+	for (size_t cy = cy0; cy <= cy1 && !crossed; cy++)
+		for (size_t cx = cx0; cx <= cx1 && !crossed; cx++)
+			crossed = m->cell_state[cy * m->nx + cx] == VR_MASK_CROSSED;
+	if (!crossed)
+	{
+		if (m->cell_state[cy0 * m->nx + cx0] == VR_MASK_OUT)
+		{
+			m->n_outside++;
+			return;
+		}
+		m->n_inside++;
+		new_ring(c);
+		for (size_t i = 0; i < k; i++)
+			push_point(c, m->cell[i]);
+		return;
+	}
+
+	// clip the segments of the grid cells, once each
+	m->stamp++;
+	size_t n = 0;
+	for (size_t cy = cy0; cy <= cy1; cy++)
+		for (size_t cx = cx0; cx <= cx1; cx++)
+		{
+			size_t g = cy * m->nx + cx;
+			for (size_t i = m->cell_start[g]; i < m->cell_start[g+1]; i++)
+			{
+				size_t s = m->cell_segs[i];
+				if (m->seen[s] == m->stamp)
+					continue;
+				m->seen[s] = m->stamp;
+				n = clip_segment(m, k, s, n);
+			}
+		}
+
+	size_t n_entries = 0;
+	for (size_t i = 0; i < n; i++)
+		if (m->pieces[i].in >= 0)
+			m->entries[n_entries++] = &m->pieces[i];
+	if (n_entries != 0)
+		qsort(m->entries, n_entries, sizeof(vr_mask_piece_t*), cmp_entry);
+
+	// when the mask does not cross the boundary of the cell, the
+	// boundary is either kept whole or dropped; with no segment in the
+	// cell either, the cell is then entirely inside or outside
+	if (n_entries == 0)
+	{
+		char inside = vr_mask_inside(m, m->cell[0]);
+		if (inside)
+		{
+			new_ring(c);
+			for (size_t i = 0; i < k; i++)
+				push_point(c, m->cell[i]);
+		}
+		if (n == 0)
+		{
+			if (inside)
+				m->n_inside++;
+			else
+				m->n_outside++;
+			return;
+		}
+	}
+	m->n_clipped++;
+
+	// the rings through the boundary, then those inside
+	for (size_t i = 0; i < n_entries; i++)
+		if (!m->entries[i]->done)
+			follow(m, c, k, n_entries, m->entries[i]);
+	for (size_t i = 0; i < n; i++)
+		if (!m->pieces[i].done)
+			follow(m, c, k, n_entries, &m->pieces[i]);
+
+	for (size_t i = 0; i < n; i++)
+		m->piece_of[m->pieces[i].seg] = VR_NONE;
+}
+
+void vr_mask_clip(vr_mask_t* m, vr_masked_t* c, vr_diagram_t* v)
+{
+	size_t n_cells = m->n_points + v->n_regions;
+	if (m->n_cells != n_cells)
+		vr_mask_index(m, n_cells);
+
+	m->n_inside  = 0;
+	m->n_outside = 0;
+	m->n_clipped = 0;
+	m->n_open    = 0;
+
+	c->n_regions    = v->n_regions;
+	c->region_start = CREALLOC(c->region_start, size_t, v->n_regions);
+	c->region_end   = CREALLOC(c->region_end,   size_t, v->n_regions);
+	c->n_rings      = 0;
+	c->n_points     = 0;
+	new_ring(c); // make room for the end of the last ring
+	c->n_rings = 0;
+
+	// in the order of the sweep when the sites were given at once,
+	// since the edges, and so the cells, were built in that order
+	char swept = v->n_sites == v->n_regions;
+	for (size_t i = 0; i < v->n_regions; i++)
+	{
+		vr_region_t* r = swept ? v->sites[i] : v->regions[i];
+		c->region_start[r->id] = c->n_rings;
+		clip_region(m, c, r);
+		c->region_end[r->id] = c->n_rings;
+	}
+	c->ring_start[c->n_rings] = c->n_points;
+}
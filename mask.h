@@ -0,0 +1,134 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef MASK_H
+#define MASK_H
+
+typedef struct vr_mask_piece vr_mask_piece_t;
+typedef struct vr_mask       vr_mask_t;
+typedef struct vr_masked     vr_masked_t;
+
+#include "voronoi.h"
+
+// state of a grid cell
+#define VR_MASK_OUT     0
+#define VR_MASK_IN      1
+#define VR_MASK_CROSSED 2
+
+// part of a mask segment inside a cell; in and out are the positions
+// along the boundary of the cell where it enters and leaves it (edge
+// index plus fraction), -1 if it starts or ends inside
+struct vr_mask_piece
+{
+	size_t  seg;
+	point_t a;
+	point_t b;
+	double  in;
+	double  out;
+	char    done;
+};
+
+// polygon with holes to restrict the cells to; segment i goes from
+// point i to point next[i] of the same ring, with the inside on its
+// left (outer rings are counter-clockwise, holes clockwise)
+//
+// the segments are indexed in a uniform grid over their bounding box,
+// the cells of which are sized after the mask and the diagram; grid
+// cells crossed by no segment are entirely inside or outside, so that
+// the cells of the diagram covering only such grid cells are kept or
+// dropped without being clipped
+struct vr_mask
+{
+	size_t   n_points;
+	size_t   a_points;
+	point_t* points;
+	size_t*  next;
+
+	// grid of nx x ny cells of size cw x ch from (x0,y0), built for
+	// about n_cells cells (0 if not built); the segments crossing cell
+	// c are cell_segs[cell_start[c] .. cell_start[c+1]), and its state
+	// is cell_state[c] (a byte, for the cells of the diagram to be
+	// tested against the grid with few cache misses)
+	size_t  n_cells;
+	size_t  nx;
+	size_t  ny;
+	double  x0;
+	double  y0;
+	double  cw;
+	double  ch;
+	size_t* cell_start;
+	size_t* cell_segs;
+	char*   cell_state;
+
+	// clipping scratch, kept across calls
+	size_t            a_cell;
+	point_t*          cell; // boundary of the current cell
+	size_t            a_pieces;
+	vr_mask_piece_t*  pieces;
+	size_t*           piece_of; // by segment, VR_NONE if none
+	size_t*           seen;     // by segment, last stamp that gathered it
+	size_t            stamp;
+	size_t            a_entries;
+	vr_mask_piece_t** entries;  // pieces entering the cell, by position
+
+	// statistics of the last vr_mask_clip()
+	size_t n_inside;  // kept as is
+	size_t n_outside; // dropped
+	size_t n_clipped;
+	size_t n_open;    // left out, their boundary could not be closed
+};
+
+// the cells of a diagram restricted to a mask: the rings of region i
+// are rings [region_start[i], region_end[i]), and the points of ring j
+// are points [ring_start[j], ring_start[j+1]); like those of the mask,
+// outer rings are counter-clockwise and holes clockwise
+struct vr_masked
+{
+	size_t   n_regions;
+	size_t*  region_start;
+	size_t*  region_end;
+	size_t   n_rings;
+	size_t   a_rings;
+	size_t*  ring_start;
+	size_t   n_points;
+	size_t   a_points;
+	point_t* points;
+};
+
+void vr_mask_init(vr_mask_t* m);
+void vr_mask_exit(vr_mask_t* m);
+
+// add a ring of n points, in either orientation; it is a hole if hole
+// is set, and rings are assumed not to cross each other
+void vr_mask_ring(vr_mask_t* m, size_t n, const point_t* p, char hole);
+
+// (re)build the grid with about n_cells cells; vr_mask_clip() does it
+// when needed
+void vr_mask_index(vr_mask_t* m, size_t n_cells);
+
+// whether p is inside the mask
+char vr_mask_inside(vr_mask_t* m, point_t p);
+
+void vr_masked_init(vr_masked_t* c);
+void vr_masked_exit(vr_masked_t* c);
+
+// restrict the cells of v to m into c, after vr_diagram_end(); the
+// arrays of c are reused when it is passed again
+void vr_mask_clip(vr_mask_t* m, vr_masked_t* c, vr_diagram_t* v);
+
+#endif
@@ -0,0 +1,695 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "parallel.h"
+
+#include <string.h>
+#include <math.h>
+
+#include "utils.h"
+#include "radix.h"
+
+/*
+A site of a slab or of a tile is owned by it, and its cell is exact
+when no site left out of the sweep is closer to a vertex of the cell
+than the site itself: the cell is then cut by no other bisector. Since
+all the sites within some window are swept, this is the case when each
+vertex q of the cell of site s is further from the sides of the window
+than from s (only the sides with sites beyond matter).
+
+Each edge is kept from the cell of its region of lower index (border
+edges have a single region), and the vertices are merged by position:
+vertices and border crossings only depend on the sites they come from,
+so they are the same in all the sweeps. This no longer holds with
+cocircular sites, as on a lattice: the edge of no length that links
+their vertices, and the triple each vertex is computed from, depend on
+the order of the events, which differs between sweeps of different
+sites. So the edges between cells of different parts are also kept
+from the cell of higher index, as twins, and when a twin is not the
+same as its edge, the sweeps do not agree and the diagram is rather
+built by a single sweep.
+*/
+typedef struct pedge pedge_t;
+struct pedge
+{
+	point_t  a;
+	point_t  b;
+	uint32_t ra;
+	uint32_t rb;
+};
+
+typedef struct pedges pedges_t;
+struct pedges
+{
+	size_t   n;
+	size_t   a;
+	pedge_t* e;
+};
+
+// a slab or a tile
+typedef struct part part_t;
+struct part
+{
+	size_t lo; // owned sites, in order
+	size_t hi;
+
+	pedges_t edges;  // from the cells of lower index
+	pedges_t shared; // same, for edges with a cell of another part
+	pedges_t twins;  // these, from the cells of higher index
+
+	size_t n_sweeps;
+};
+
+typedef struct box box_t;
+struct box
+{
+	double x0;
+	double y0;
+	double x1;
+	double y1;
+};
+
+typedef struct worker worker_t;
+struct worker
+{
+	vr_diagram_t v;
+	size_t       a_ids;
+	uint32_t*    ids; // sites of the regions of v
+};
+
+typedef struct split split_t;
+struct split
+{
+	double         w;
+	double         h;
+	size_t         n;
+	const point_t* p;
+
+	uint32_t* order; // sites by abscissa, grouped by tile for tiles
+	double*   xs;    // their abscissas, for slabs
+
+	size_t  tx; // tiles
+	size_t  ty;
+	box_t   bounds; // of the sites
+
+	double    halo; // initial distance to the part
+	part_t*   parts;
+	worker_t* workers; // one per thread
+};
+
+// first i such that xs[i] >= x (or > x if 'after')
+static size_t bisect(const double* xs, size_t n, double x, char after)
+{
+	size_t a = 0;
+	size_t b = n;
+	while (a < b)
+	{
+		size_t m = a + (b-a)/2;
+		if (xs[m] < x || (after && xs[m] == x))
+			a = m+1;
+		else
+			b = m;
+	}
+	return a;
+}
+
+// whether the cell of r is exact, when no site left out of the sweep
+// is strictly inside b; also widens *need to the box that would make it
+// so (the cell can only shrink as sites are added, and x-|q-s| is
+// concave, so it is enough to look at the current vertices)
+static char exact(vr_region_t* r, const box_t* b, box_t* need)
+{
+	if (r->hedge == NULL)
+	{
+		*need = (box_t){-HUGE_VAL, -HUGE_VAL, HUGE_VAL, HUGE_VAL};
+		return 0;
+	}
+
+	char ret = 1;
+	for (size_t j = 0; j < r->n_edges; j++)
+	{
+		point_t* q = r->edges[j]->s.a;
+		for (int k = 0; k < 2; k++, q = r->edges[j]->s.b)
+		{
+			double dx = q->x - r->p.x;
+			double dy = q->y - r->p.y;
+			double d2 = dx*dx + dy*dy;
+			double m[4] = {q->x - b->x0, q->y - b->y0, b->x1 - q->x, b->y1 - q->y};
+			for (int i = 0; i < 4; i++)
+				if (m[i] <= 0 || m[i]*m[i] <= d2)
+					ret = 0;
+
+			double d = sqrt(d2);
+			need->x0 = fmin(need->x0, q->x - d);
+			need->y0 = fmin(need->y0, q->y - d);
+			need->x1 = fmax(need->x1, q->x + d);
+			need->y1 = fmax(need->y1, q->y + d);
+		}
+	}
+	return ret;
+}
+
+// next window to try, from what the cells require, or twice as large
+// when some are open
+static void widen(box_t* win, const box_t* need, double halo)
+{
+	double dx = win->x1 - win->x0;
+	double dy = win->y1 - win->y0;
+	win->x0 = need->x0 == -HUGE_VAL ? win->x0 - dx : fmin(need->x0, win->x0 - halo);
+	win->y0 = need->y0 == -HUGE_VAL ? win->y0 - dy : fmin(need->y0, win->y0 - halo);
+	win->x1 = need->x1 ==  HUGE_VAL ? win->x1 + dx : fmax(need->x1, win->x1 + halo);
+	win->y1 = need->y1 ==  HUGE_VAL ? win->y1 + dy : fmax(need->y1, win->y1 + halo);
+}
+
+// build the diagram of sites ids[0..m-1] in v
+static void sweep(split_t* sp, vr_diagram_t* v, const uint32_t* ids, size_t m)
+{
+	vr_diagram_reset(v);
+	point_t* pts = vr_scratch_reserve(vr_diagram_scratch(v, 1), m);
+	for (size_t j = 0; j < m; j++)
+		pts[j] = sp->p[ids[j]];
+	vr_diagram_points(v, m, pts);
+	vr_diagram_end(v);
+}
+
+static void push_edge(pedges_t* l, pedge_t e)
+{
+	if (l->n == l->a)
+	{
+		l->a = l->a == 0 ? 64 : 2*l->a;
+		l->e = CREALLOC(l->e, pedge_t, l->a);
+	}
+	l->e[l->n++] = e;
+}
+
+// keep the edges from the cells of regions a to b-1 of v, whose sites
+// are given by ids, and the twins of those shared with other parts
+static void keep_edges(part_t* s, vr_diagram_t* v, const uint32_t* ids, size_t a, size_t b)
+{
+	for (size_t j = a; j < b; j++)
+	{
+		vr_region_t* r = v->regions[j];
+		uint32_t id = ids[j];
+		for (size_t k = 0; k < r->n_edges; k++)
+		{
+			vr_edge_t* e = r->edges[k];
+			vr_region_t* o = e->ra == r ? e->rb : e->ra;
+			uint32_t oid = o != NULL ? ids[o->id] : VR_FLAT_NONE;
+			char shared = o != NULL && (o->id < a || o->id >= b);
+			if (oid < id && !shared)
+				continue;
+
+			uint32_t ra = ids[e->ra->id];
+			uint32_t rb = e->rb != NULL ? ids[e->rb->id] : VR_FLAT_NONE;
+			pedges_t* l = oid < id ? &s->twins : shared ? &s->shared : &s->edges;
+			push_edge(l, (pedge_t){*e->s.a, *e->s.b, ra, rb});
+		}
+	}
+}
+
+static void sweep_slabs(void* arg, size_t thread, size_t a, size_t b)
+{
+	split_t* sp = (split_t*) arg;
+	vr_diagram_t* v = &sp->workers[thread].v;
+	size_t n = sp->n;
+
+	for (size_t i = a; i < b; i++)
+	{
+		part_t* s = &sp->parts[i];
+		s->edges.n  = 0;
+		s->shared.n = 0;
+		s->twins.n  = 0;
+		s->n_sweeps = 0;
+
+		box_t win = {sp->xs[s->lo] - sp->halo, -HUGE_VAL, sp->xs[s->hi-1] + sp->halo, HUGE_VAL};
+		size_t il, ih;
+		while (1)
+		{
+			// sites within the window
+			il = bisect(sp->xs, n, win.x0, 0);
+			ih = bisect(sp->xs, n, win.x1, 1);
+			sweep(sp, v, sp->order + il, ih - il);
+			s->n_sweeps++;
+
+			if (il == 0 && ih == n)
+				break;
+
+			// the closest sites left out
+			box_t out = {il > 0 ? sp->xs[il-1] : -HUGE_VAL, -HUGE_VAL,
+			             ih < n ? sp->xs[ih]   :  HUGE_VAL,  HUGE_VAL};
+			box_t need = win;
+			char ok = 1;
+			for (size_t j = s->lo; j < s->hi; j++)
+				ok &= exact(v->regions[j-il], &out, &need);
+			if (ok)
+				break;
+			widen(&win, &need, sp->halo);
+		}
+
+		keep_edges(s, v, sp->order + il, s->lo - il, s->hi - il);
+	}
+}
+
+static size_t tile_of(double x, double w, size_t n)
+{
+	if (!(x > 0))
+		return 0;
+	size_t i = x / w * n;
+	return i < n ? i : n-1;
+}
+
+// append to wk->ids (holding m sites) those of tile t within win, or
+// all of them when win is NULL (for the tile being swept: the sites out
+// of the box are in the tiles of its sides); returns the new count
+static size_t gather(split_t* sp, worker_t* wk, size_t t, const box_t* win, size_t m)
+{
+	part_t* o = &sp->parts[t];
+	if (m + (o->hi - o->lo) > wk->a_ids)
+	{
+		while (m + (o->hi - o->lo) > wk->a_ids)
+			wk->a_ids = wk->a_ids == 0 ? 1024 : 2*wk->a_ids;
+		wk->ids = CREALLOC(wk->ids, uint32_t, wk->a_ids);
+	}
+	for (size_t k = o->lo; k < o->hi; k++)
+	{
+		uint32_t id = sp->order[k];
+		const point_t* q = &sp->p[id];
+		if (win == NULL || (win->x0 <= q->x && q->x <= win->x1 && win->y0 <= q->y && q->y <= win->y1))
+			wk->ids[m++] = id;
+	}
+	return m;
+}
+
+static void sweep_tiles(void* arg, size_t thread, size_t a, size_t b)
+{
+	split_t* sp = (split_t*) arg;
+	worker_t* wk = &sp->workers[thread];
+	vr_diagram_t* v = &wk->v;
+	size_t tx = sp->tx;
+	size_t ty = sp->ty;
+
+	for (size_t i = a; i < b; i++)
+	{
+		part_t* s = &sp->parts[i];
+		s->edges.n  = 0;
+		s->shared.n = 0;
+		s->twins.n  = 0;
+		s->n_sweeps = 0;
+
+		size_t n_own = s->hi - s->lo;
+		if (n_own == 0)
+			continue;
+
+		size_t cx = i % tx;
+		size_t cy = i / tx;
+		box_t win =
+		{
+			cx     * sp->w / tx - sp->halo, cy     * sp->h / ty - sp->halo,
+			(cx+1) * sp->w / tx + sp->halo, (cy+1) * sp->h / ty + sp->halo,
+		};
+		size_t m;
+		size_t own = 0;
+		while (1)
+		{
+			// the sites within the window, column by column so
+			// that the regions are about in abscissa order; the
+			// owned ones are own to own+n_own-1
+			m = 0;
+			size_t jx0 = tile_of(win.x0, sp->w, tx);
+			size_t jx1 = tile_of(win.x1, sp->w, tx);
+			size_t jy0 = tile_of(win.y0, sp->h, ty);
+			size_t jy1 = tile_of(win.y1, sp->h, ty);
+			for (size_t jx = jx0; jx <= jx1; jx++)
+				for (size_t jy = jy0; jy <= jy1; jy++)
+				{
+					size_t t = jy * tx + jx;
+					if (t == i)
+						own = m;
+					m = gather(sp, wk, t, t == i ? NULL : &win, m);
+				}
+			sweep(sp, v, wk->ids, m);
+			s->n_sweeps++;
+
+			if (m == sp->n)
+				break;
+
+			// nothing is left out beyond the sites
+			box_t out =
+			{
+				win.x0 <= sp->bounds.x0 ? -HUGE_VAL : win.x0,
+				win.y0 <= sp->bounds.y0 ? -HUGE_VAL : win.y0,
+				win.x1 >= sp->bounds.x1 ?  HUGE_VAL : win.x1,
+				win.y1 >= sp->bounds.y1 ?  HUGE_VAL : win.y1,
+			};
+			box_t need = win;
+			char ok = 1;
+			for (size_t j = own; j < own + n_own; j++)
+				ok &= exact(v->regions[j], &out, &need);
+			if (ok)
+				break;
+			widen(&win, &need, sp->halo);
+		}
+
+		keep_edges(s, v, wk->ids, own, own + n_own);
+	}
+}
+
+// merge vertices by position
+typedef struct vmap vmap_t;
+struct vmap
+{
+	size_t    mask;
+	uint32_t* slots; // vertex id + 1, 0 if empty
+};
+
+static uint64_t point_hash(point_t p)
+{
+	uint64_t x, y;
+	memcpy(&x, &p.x, sizeof(x));
+	memcpy(&y, &p.y, sizeof(y));
+	uint64_t k = x * 0x9E3779B97F4A7C15ULL ^ (y + 0x632BE59BD9B4E019ULL + (x << 6) + (x >> 2));
+	k ^= k >> 29;
+	k *= 0xBF58476D1CE4E5B9ULL;
+	return k ^ (k >> 32);
+}
+
+static uint32_t vertex_id(vr_flat_t* f, vmap_t* m, point_t p)
+{
+	size_t i = point_hash(p) & m->mask;
+	while (m->slots[i] != 0)
+	{
+		uint32_t id = m->slots[i] - 1;
+		if (f->vx[id] == p.x && f->vy[id] == p.y)
+			return id;
+		i = (i + 1) & m->mask;
+	}
+	uint32_t id = f->n_vertices++;
+	f->vx[id] = p.x;
+	f->vy[id] = p.y;
+	m->slots[i] = id + 1;
+	return id;
+}
+
+// shared edges by their regions, to find those of the twins
+typedef struct emap emap_t;
+struct emap
+{
+	size_t    mask;
+	pedge_t** slots;
+};
+
+static uint64_t pair_hash(uint32_t a, uint32_t b)
+{
+	uint64_t k = (uint64_t) (a < b ? a : b) << 32 | (a < b ? b : a);
+	k ^= k >> 33;
+	k *= 0xFF51AFD7ED558CCDULL;
+	return k ^ (k >> 33);
+}
+
+static char same_pair(const pedge_t* e, const pedge_t* f)
+{
+	return (e->ra == f->ra && e->rb == f->rb) || (e->ra == f->rb && e->rb == f->ra);
+}
+
+static char same_point(point_t p, point_t q)
+{
+	return p.x == q.x && p.y == q.y;
+}
+
+// whether each shared edge has a twin with the same ends, and only one
+static char agree(split_t* sp, size_t n_parts)
+{
+	size_t n_shared = 0;
+	size_t n_twins  = 0;
+	for (size_t i = 0; i < n_parts; i++)
+	{
+		n_shared += sp->parts[i].shared.n;
+		n_twins  += sp->parts[i].twins.n;
+	}
+	if (n_shared != n_twins)
+		return 0;
+
+	emap_t m;
+	size_t size = 16;
+	while (size < 2*n_shared)
+		size *= 2;
+	m.mask  = size - 1;
+	m.slots = CALLOC(pedge_t*, size);
+	memset(m.slots, 0, size * sizeof(pedge_t*));
+
+	char ret = 1;
+	for (size_t i = 0; ret && i < n_parts; i++)
+	{
+		pedges_t* l = &sp->parts[i].shared;
+		for (size_t j = 0; ret && j < l->n; j++)
+		{
+			pedge_t* e = &l->e[j];
+			size_t k = pair_hash(e->ra, e->rb) & m.mask;
+			for (; m.slots[k] != NULL; k = (k + 1) & m.mask)
+				if (same_pair(m.slots[k], e))
+					ret = 0;
+			m.slots[k] = e;
+		}
+	}
+	for (size_t i = 0; ret && i < n_parts; i++)
+	{
+		pedges_t* l = &sp->parts[i].twins;
+		for (size_t j = 0; ret && j < l->n; j++)
+		{
+			pedge_t* t = &l->e[j];
+			size_t k = pair_hash(t->ra, t->rb) & m.mask;
+			while (m.slots[k] != NULL && !same_pair(m.slots[k], t))
+				k = (k + 1) & m.mask;
+			pedge_t* e = m.slots[k];
+			ret = e != NULL &&
+				((same_point(e->a, t->a) && same_point(e->b, t->b)) ||
+				 (same_point(e->a, t->b) && same_point(e->b, t->a)));
+		}
+	}
+	free(m.slots);
+	return ret;
+}
+
+static void merge(vr_flat_t* f, split_t* sp, size_t n_parts)
+{
+	size_t n_edges = 0;
+	for (size_t i = 0; i < n_parts; i++)
+		n_edges += sp->parts[i].edges.n + sp->parts[i].shared.n;
+
+	f->n_edges = n_edges;
+	f->ea = CREALLOC(f->ea, uint32_t, n_edges);
+	f->eb = CREALLOC(f->eb, uint32_t, n_edges);
+	f->ra = CREALLOC(f->ra, uint32_t, n_edges);
+	f->rb = CREALLOC(f->rb, uint32_t, n_edges);
+
+	// at most two vertices per edge
+	f->n_vertices = 0;
+	f->vx = CREALLOC(f->vx, double, 2*n_edges);
+	f->vy = CREALLOC(f->vy, double, 2*n_edges);
+
+	vmap_t m;
+	size_t size = 16;
+	while (size < 4*n_edges)
+		size *= 2;
+	m.mask  = size - 1;
+	m.slots = CALLOC(uint32_t, size);
+	memset(m.slots, 0, size * sizeof(uint32_t));
+
+	size_t k = 0;
+	for (size_t i = 0; i < n_parts; i++)
+	{
+		part_t* s = &sp->parts[i];
+		for (size_t j = 0; j < s->edges.n + s->shared.n; j++, k++)
+		{
+			pedge_t* e = j < s->edges.n ? &s->edges.e[j] : &s->shared.e[j - s->edges.n];
+			f->ea[k] = vertex_id(f, &m, e->a);
+			f->eb[k] = vertex_id(f, &m, e->b);
+			f->ra[k] = e->ra;
+			f->rb[k] = e->rb;
+		}
+	}
+	free(m.slots);
+
+	f->n_regions = sp->n;
+	f->sx = CREALLOC(f->sx, double, sp->n);
+	f->sy = CREALLOC(f->sy, double, sp->n);
+	for (size_t i = 0; i < sp->n; i++)
+	{
+		f->sx[i] = sp->p[i].x;
+		f->sy[i] = sp->p[i].y;
+	}
+}
+
+static void split_init(split_t* sp, double w, double h, size_t n, const point_t* p)
+{
+	sp->w = w;
+	sp->h = h;
+	sp->n = n;
+	sp->p = p;
+
+	// sort the sites by abscissa, which also makes the sweeps faster
+	// (the regions are then visited about in memory order)
+	sp->order = CALLOC(uint32_t, n);
+	sp->xs    = CALLOC(double,   n);
+	void** items = CALLOC(void*, n);
+	for (size_t i = 0; i < n; i++)
+	{
+		sp->xs[i] = p[i].x;
+		items[i] = (void*) &p[i];
+	}
+	radix_t sort;
+	radix_init(&sort);
+	radix_sort(&sort, n, sp->xs, items);
+	radix_exit(&sort);
+	for (size_t i = 0; i < n; i++)
+		sp->order[i] = (const point_t*) items[i] - p;
+	free(items);
+
+	sp->tx    = 0;
+	sp->ty    = 0;
+
+	// a few times the mean distance between sites
+	sp->halo = n != 0 ? 5 * sqrt(w * h / n) : 0;
+}
+
+// sweep the parts on the threads, each with its own diagram, then merge
+// them into f, or sweep all the sites at once when they do not agree;
+// returns the number of sweeps
+static size_t split_run(split_t* sp, vr_flat_t* f, threads_t* t, size_t n_parts,
+	void (*sweep_parts)(void*, size_t, size_t, size_t))
+{
+	size_t n_threads = t != NULL ? t->n_threads : 1;
+	sp->workers = CALLOC(worker_t, n_threads);
+	for (size_t i = 0; i < n_threads; i++)
+	{
+		vr_diagram_init(&sp->workers[i].v, sp->w, sp->h, n_parts != 0 ? 2 * sp->n / n_parts : 0);
+		sp->workers[i].a_ids = 0;
+		sp->workers[i].ids   = NULL;
+	}
+
+	if (t != NULL)
+		threads_run(t, n_parts, sweep_parts, sp);
+	else
+		sweep_parts(sp, 0, 0, n_parts);
+
+	size_t n_sweeps = 0;
+	if (agree(sp, n_parts))
+		merge(f, sp, n_parts);
+	else
+	{
+		vr_diagram_t* v = &sp->workers[0].v;
+		vr_diagram_reset(v);
+		vr_diagram_points(v, sp->n, sp->p);
+		vr_diagram_end(v);
+		vr_flat_build(f, v);
+		n_sweeps++;
+	}
+
+	for (size_t i = 0; i < n_threads; i++)
+	{
+		vr_diagram_exit(&sp->workers[i].v);
+		free(sp->workers[i].ids);
+	}
+	free(sp->workers);
+
+	for (size_t i = 0; i < n_parts; i++)
+	{
+		n_sweeps += sp->parts[i].n_sweeps;
+		free(sp->parts[i].edges.e);
+		free(sp->parts[i].shared.e);
+		free(sp->parts[i].twins.e);
+	}
+	free(sp->parts);
+	free(sp->xs);
+	free(sp->order);
+	return n_sweeps;
+}
+
+size_t vr_parallel_slabs(vr_flat_t* f, double w, double h, size_t n, const point_t* p,
+	threads_t* t, size_t n_slabs)
+{
+	if (n_slabs == 0)
+		n_slabs = t != NULL ? t->n_threads : 1;
+	if (n_slabs > n)
+		n_slabs = n;
+
+	split_t sp;
+	split_init(&sp, w, h, n, p);
+
+	// slabs of about the same number of sites
+	sp.parts = CALLOC(part_t, n_slabs);
+	for (size_t i = 0; i < n_slabs; i++)
+		sp.parts[i] = (part_t){i * n / n_slabs, (i+1) * n / n_slabs, {0, 0, NULL}, {0, 0, NULL}, {0, 0, NULL}, 0};
+
+	return split_run(&sp, f, t, n_slabs, sweep_slabs);
+}
+
+size_t vr_parallel_tiles(vr_flat_t* f, double w, double h, size_t n, const point_t* p,
+	threads_t* t, size_t tile_sites)
+{
+	if (tile_sites == 0)
+		tile_sites = VR_TILE_SITES;
+
+	split_t sp;
+	split_init(&sp, w, h, n, p);
+
+	// about square tiles, enough for all the threads
+	size_t n_tiles = (n + tile_sites-1) / tile_sites;
+	size_t n_threads = t != NULL ? t->n_threads : 1;
+	if (n_tiles < n_threads)
+		n_tiles = n_threads;
+	sp.tx = (size_t) round(sqrt(n_tiles * w / h));
+	if (sp.tx == 0)
+		sp.tx = 1;
+	sp.ty = (n_tiles + sp.tx-1) / sp.tx;
+	n_tiles = sp.tx * sp.ty;
+
+	// bucket the sites by tile, keeping the abscissa order
+	sp.parts = CALLOC(part_t, n_tiles);
+	memset(sp.parts, 0, n_tiles * sizeof(part_t));
+	uint32_t* tile = CALLOC(uint32_t, n);
+	sp.bounds = (box_t){HUGE_VAL, HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+	for (size_t i = 0; i < n; i++)
+	{
+		tile[i] = tile_of(p[i].y, h, sp.ty) * sp.tx + tile_of(p[i].x, w, sp.tx);
+		sp.parts[tile[i]].hi++;
+
+		sp.bounds.x0 = fmin(sp.bounds.x0, p[i].x);
+		sp.bounds.y0 = fmin(sp.bounds.y0, p[i].y);
+		sp.bounds.x1 = fmax(sp.bounds.x1, p[i].x);
+		sp.bounds.y1 = fmax(sp.bounds.y1, p[i].y);
+	}
+	size_t k = 0;
+	for (size_t i = 0; i < n_tiles; i++)
+	{
+		sp.parts[i].lo = k;
+		k += sp.parts[i].hi;
+		sp.parts[i].hi = sp.parts[i].lo;
+	}
+	uint32_t* order = CALLOC(uint32_t, n);
+	for (size_t i = 0; i < n; i++)
+	{
+		uint32_t id = sp.order[i];
+		order[sp.parts[tile[id]].hi++] = id;
+	}
+	free(sp.order);
+	sp.order = order;
+	free(tile);
+
+	return split_run(&sp, f, t, n_tiles, sweep_tiles);
+}
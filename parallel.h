@@ -0,0 +1,47 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "voronoi.h"
+#include "flat.h"
+#include "threads.h"
+
+// build the diagram of the n sites p in a w x h box on the threads of t
+// (may be NULL); the sites are split into n_slabs vertical slabs by
+// abscissa (0 for one per thread), each one swept with its neighbours
+// up to some distance, which is widened until the cells of all the
+// sites of the slab are known to be exact; the result is the same as
+// with a single sweep, region i being the one of site p[i]; with
+// cocircular sites, the sweeps may not agree on the edges between
+// slabs, and the diagram is then built by a single sweep
+//
+// returns the number of sweeps done
+size_t vr_parallel_slabs(vr_flat_t* f, double w, double h, size_t n, const point_t* p,
+	threads_t* t, size_t n_slabs);
+
+#define VR_TILE_SITES 65536
+
+// same, with the box split into tiles of about tile_sites sites (0 for
+// VR_TILE_SITES), but at least one per thread; the memory of a sweep is
+// then bounded by the size of a tile and of its halo
+size_t vr_parallel_tiles(vr_flat_t* f, double w, double h, size_t n, const point_t* p,
+	threads_t* t, size_t tile_sites);
+
+#endif
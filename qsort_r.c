@@ -18,17 +18,18 @@
 
 #include "qsort_r.h"
 
-#include <string.h>
-#include <stdlib.h>
-
 static void xchg(char *base, size_t size, size_t a, size_t b)
 {
 	if (a != b)
 	{
-		char buffer[size];
-		memcpy(buffer,      base+a*size, size);
-		memcpy(base+a*size, base+b*size, size);
-		memcpy(base+b*size, buffer,      size);
+		char* p = base+a*size;
+		char* q = base+b*size;
+		for (size_t i = 0; i < size; i++)
+		{
+			char c = p[i];
+			p[i] = q[i];
+			q[i] = c;
+		}
 	}
 }
 
@@ -45,27 +46,42 @@ static void aux(char *base, size_t nmemb, size_t size,
 		return;
 	}
 
-	// choose pivot
-	size_t p = a + (rand() % (b-a));
+	// choose pivot (median of three)
+	size_t p = a + (b-a)/2;
+	if (compar(base+a*size, base+p*size, arg) > 0)
+		xchg(base, size, a, p);
+	if (compar(base+p*size, base+b*size, arg) > 0)
+	{
+		xchg(base, size, p, b);
+		if (compar(base+a*size, base+p*size, arg) > 0)
+			xchg(base, size, a, p);
+	}
 
-	// partition
+	// partition, with the pivot at b; both scans stop on keys equal to
+	// the pivot, which are then swapped, so that runs of equal keys are
+	// split in the middle rather than all put on one side
 	xchg(base, size, p, b);
-	p = b;
-	size_t s = a;
-	for (size_t i = a; i < b; i++)
+	const char* pivot = base+b*size;
+	size_t i = a;
+	size_t j = b;
+	while (1)
 	{
-		if (compar(base+i*size, base+p*size, arg) <= 0)
-		{
-			xchg(base, size, i, s);
-			s++;
-		}
+		while (compar(base+i*size, pivot, arg) < 0) // stops at b at last
+			i++;
+		do
+			j--;
+		while (j > i && compar(base+j*size, pivot, arg) > 0);
+		if (j <= i)
+			break;
+		xchg(base, size, i, j);
+		i++;
 	}
-	xchg(base, size, s, p);
+	xchg(base, size, i, b);
 
 	// recursive sorting
-	if (s > 0)
-		aux(base, nmemb, size, compar, arg, a, s-1);
-	aux(base, nmemb, size, compar, arg, s+1, b);
+	if (i > a)
+		aux(base, nmemb, size, compar, arg, a, i-1);
+	aux(base, nmemb, size, compar, arg, i+1, b);
 }
 
 void qsort_r(void *base, size_t nmemb, size_t size,
@@ -0,0 +1,123 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "radix.h"
+
+#include <string.h>
+
+#include "utils.h"
+
+/*
+IEEE 754 doubles compare like sign-magnitude integers: flipping the sign
+bit of positive values and all the bits of negative ones gives unsigned
+integers with the same order. They are then sorted by an LSD radix sort
+on bytes, skipping the passes where all the keys share the same byte
+(typically the exponent bytes).
+*/
+
+static inline uint64_t key_bits(double x)
+{
+	uint64_t k;
+	memcpy(&k, &x, sizeof(k));
+	return k & 0x8000000000000000ULL ? ~k : k | 0x8000000000000000ULL;
+}
+
+static inline double bits_key(uint64_t k)
+{
+	k = k & 0x8000000000000000ULL ? k & ~0x8000000000000000ULL : ~k;
+	double x;
+	memcpy(&x, &k, sizeof(x));
+	return x;
+}
+
+void radix_init(radix_t* r)
+{
+	r->avail = 0;
+	r->keys  = NULL;
+	r->items = NULL;
+}
+
+void radix_exit(radix_t* r)
+{
+	free(r->items);
+	free(r->keys);
+}
+
+void radix_sort(radix_t* r, size_t n, double* keys, void** items)
+{
+	if (n < 2)
+		return;
+
+	if (n > r->avail)
+	{
+		r->avail = n;
+		r->keys  = CREALLOC(r->keys,  uint64_t, 2*n);
+		r->items = CREALLOC(r->items, void*,    n);
+	}
+	uint64_t* k   = r->keys;
+	void**    it  = r->items;
+	uint64_t* k2  = k + n;
+
+	// count all digits at once
+	size_t count[8][256];
+	memset(count, 0, sizeof(count));
+	for (size_t i = 0; i < n; i++)
+	{
+		k[i] = key_bits(keys[i]);
+		for (size_t d = 0; d < 8; d++)
+			count[d][(k[i] >> (8*d)) & 0xff]++;
+	}
+
+	uint64_t* src_k  = k;
+	uint64_t* dst_k  = k2;
+	void**    src_it = items;
+	void**    dst_it = it;
+	for (size_t d = 0; d < 8; d++)
+	{
+		size_t shift = 8*d;
+
+		// skip trivial passes
+		if (count[d][(src_k[0] >> shift) & 0xff] == n)
+			continue;
+
+		// offsets
+		size_t sum = 0;
+		for (size_t b = 0; b < 256; b++)
+		{
+			size_t c = count[d][b];
+			count[d][b] = sum;
+			sum += c;
+		}
+
+		// scatter
+		for (size_t i = 0; i < n; i++)
+		{
+			size_t j = count[d][(src_k[i] >> shift) & 0xff]++;
+			dst_k [j] = src_k [i];
+			dst_it[j] = src_it[i];
+		}
+
+		uint64_t* tk = src_k;  src_k  = dst_k;  dst_k  = tk;
+		void**    ti = src_it; src_it = dst_it; dst_it = ti;
+	}
+
+	if (src_it != items)
+		memcpy(items, src_it, n * sizeof(void*));
+	for (size_t i = 0; i < n; i++)
+		keys[i] = bits_key(src_k[i]);
+}
@@ -0,0 +1,42 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef RADIX_H
+#define RADIX_H
+
+#include <sys/types.h>
+#include <stdint.h>
+
+typedef struct radix radix_t;
+
+// scratch space, kept from one sort to the next
+struct radix
+{
+	size_t    avail;
+	uint64_t* keys; // two halves of 'avail' keys
+	void**    items;
+};
+
+void radix_init(radix_t* r);
+void radix_exit(radix_t* r);
+
+// stable sort of n items by increasing key; keys are reordered
+// along with the items
+void radix_sort(radix_t* r, size_t n, double* keys, void** items);
+
+#endif
@@ -0,0 +1,175 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "sitefile.h"
+
+#include "utils.h"
+#include "radix.h"
+#include "heap.h"
+
+// memory used per site of a run, with the sort scratch
+#define VR_RUN_COST 80
+
+// runs merged at once, each with a file open
+#define VR_MERGE_WAY 64
+
+size_t vr_sitefile_read(void* file, point_t* p, size_t n)
+{
+	return fread(p, sizeof(point_t), n, (FILE*) file);
+}
+
+static void write_sites(FILE* f, const point_t* p, size_t n)
+{
+	if (fwrite(p, sizeof(point_t), n, f) != n)
+	{
+		fprintf(stderr, "Could not write sites\n");
+		exit(1);
+	}
+}
+
+// read up to n sites from in, sort them and write them to out
+static size_t sort_run(FILE* in, FILE* out, size_t n, point_t* buf, point_t* sorted,
+	double* keys, void** items, radix_t* r)
+{
+	n = fread(buf, sizeof(point_t), n, in);
+	for (size_t i = 0; i < n; i++)
+	{
+		keys[i]  = buf[i].x;
+		items[i] = &buf[i];
+	}
+	radix_sort(r, n, keys, items);
+	for (size_t i = 0; i < n; i++)
+		sorted[i] = *(point_t*) items[i];
+	write_sites(out, sorted, n);
+	return n;
+}
+
+// merge n sorted runs into out, by the first site of each run, and
+// close them
+static void merge_runs(FILE** runs, size_t n, FILE* out)
+{
+	point_t* heads = CALLOC(point_t, n);
+	heap_t h;
+	heap_init(&h);
+	for (size_t i = 0; i < n; i++)
+	{
+		rewind(runs[i]);
+		if (fread(&heads[i], sizeof(point_t), 1, runs[i]) == 1)
+			heap_insert(&h, heads[i].x, i);
+	}
+	while (h.size != 0)
+	{
+		uint32_t i = heap_remove(&h);
+		write_sites(out, &heads[i], 1);
+		if (fread(&heads[i], sizeof(point_t), 1, runs[i]) == 1)
+			heap_insert(&h, heads[i].x, i);
+	}
+	heap_exit(&h);
+	free(heads);
+
+	for (size_t i = 0; i < n; i++)
+		fclose(runs[i]);
+}
+
+static FILE* new_run(void)
+{
+	FILE* f = tmpfile();
+	if (f == NULL)
+	{
+		fprintf(stderr, "Could not create a temporary file\n");
+		exit(1);
+	}
+	return f;
+}
+
+size_t vr_sitefile_sort(FILE* in, FILE* out, size_t mem)
+{
+	size_t n_run = mem / VR_RUN_COST;
+	if (n_run < 1024)
+		n_run = 1024;
+
+	point_t* buf    = CALLOC(point_t, n_run);
+	point_t* sorted = CALLOC(point_t, n_run);
+	double*  keys   = CALLOC(double,  n_run);
+	void**   items  = CALLOC(void*,   n_run);
+	radix_t r;
+	radix_init(&r);
+
+	// sorted runs, on a stack where the last VR_MERGE_WAY ones are
+	// merged into one of the next level as soon as they are of the
+	// same level; levels do not increase up the stack, so that there
+	// are at most VR_MERGE_WAY-1 runs of each level, and each site is
+	// merged about log(n_runs) / log(VR_MERGE_WAY) times
+	size_t n_sites = 0;
+	size_t n_runs = 0;
+	size_t a_runs = 0;
+	FILE**  runs  = NULL;
+	size_t* level = NULL;
+	while (1)
+	{
+		FILE* f = new_run();
+		size_t n = sort_run(in, f, n_run, buf, sorted, keys, items, &r);
+		if (n == 0)
+		{
+			fclose(f);
+			break;
+		}
+		n_sites += n;
+		if (n_runs == a_runs)
+		{
+			a_runs = a_runs == 0 ? VR_MERGE_WAY : 2*a_runs;
+			runs  = CREALLOC(runs,  FILE*,  a_runs);
+			level = CREALLOC(level, size_t, a_runs);
+		}
+		runs [n_runs] = f;
+		level[n_runs] = 0;
+		n_runs++;
+
+		while (n_runs >= VR_MERGE_WAY && level[n_runs-VR_MERGE_WAY] == level[n_runs-1])
+		{
+			FILE* g = new_run();
+			n_runs -= VR_MERGE_WAY;
+			merge_runs(runs + n_runs, VR_MERGE_WAY, g);
+			runs [n_runs] = g;
+			level[n_runs]++;
+			n_runs++;
+		}
+		if (n < n_run)
+			break;
+	}
+
+	radix_exit(&r);
+	free(items);
+	free(keys);
+	free(sorted);
+	free(buf);
+
+	// the last ones, by VR_MERGE_WAY at most
+	while (n_runs > VR_MERGE_WAY)
+	{
+		FILE* g = new_run();
+		n_runs -= VR_MERGE_WAY;
+		merge_runs(runs + n_runs, VR_MERGE_WAY, g);
+		runs[n_runs++] = g;
+	}
+	merge_runs(runs, n_runs, out);
+	free(level);
+	free(runs);
+
+	return n_sites;
+}
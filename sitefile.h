@@ -0,0 +1,37 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef SITEFILE_H
+#define SITEFILE_H
+
+#include <stdio.h>
+
+#include "geometry.h"
+
+// site files are raw arrays of point_t, as written by fwrite()
+
+// vr_source_t reading from a site file sorted by abscissa (arg is the
+// FILE*, buffered by stdio)
+size_t vr_sitefile_read(void* file, point_t* p, size_t n);
+
+// sort a site file by abscissa using about mem bytes of memory: sorted
+// runs are written to temporary files, then merged into out by passes
+// over a few dozen of them at once; returns the number of sites
+size_t vr_sitefile_sort(FILE* in, FILE* out, size_t mem);
+
+#endif
@@ -0,0 +1,49 @@
+#!/bin/bash
+# Check that streaming the edges gives as many of them as keeping the
+# diagram, on inputs where edges are traced by two breakpoints up to
+# the end of the sweep: sites on a line, two sites, and grids; that
+# the cells of lattices, whose columns share abscissas and whose sites
+# are cocircular by four, are closed;
+# and that building the diagram by slabs or tiles gives the same edges
+# as a single sweep.
+#
+# usage: ./test.sh
+
+make -s || exit 1
+
+status=0
+for input in "line 2" "line 5" "uniform 2" "grid 400" "grid 2500" \
+	"lattice 2" "lattice 4" "lattice 36" "lattice 100" "lattice 2500" "lattice 3000"
+do
+	set -- $input
+	output=$(./voronoi --nogui --stats --input $1 $2 2>&1 | grep '^output:')
+	kept=$(echo "$output" | sed -n 's/^output: \([0-9]*\) edges.*/\1/p')
+	open=$(echo "$output" | sed -n 's/.* \([0-9]*\) open cells.*/\1/p')
+	streamed=$(./voronoi --nogui --stats --stream --input $1 $2 2>&1 | sed -n 's/^\([0-9]*\) edges streamed.*/\1/p')
+	if [ -z "$kept" ] || [ "$kept" != "$streamed" ]
+	then
+		echo "FAIL $1 $2: ${kept:-crash} edges kept, ${streamed:-crash} streamed"
+		status=1
+	elif [ "$open" != 0 ]
+	then
+		echo "FAIL $1 $2: $open open cells"
+		status=1
+	else
+		echo "ok   $1 $2: $kept edges"
+	fi
+done
+
+for input in "uniform 2000 -p 4" "uniform 2000 -T 100" "lattice 3000 -p 10" \
+	"lattice 3000 -T 10" "lattice 3000 -T 50" "cluster 3000 -T 100" "fan 1000 -T 500"
+do
+	set -- $input
+	differ=$(./voronoi --nogui --compare --input $1 $3 $4 $2 2>&1 | sed -n 's/^\([0-9]*\) edges differ.*/\1/p')
+	if [ "$differ" != 0 ]
+	then
+		echo "FAIL $1 $2 $3 $4: ${differ:-crash} edges differ from a single sweep"
+		status=1
+	else
+		echo "ok   $1 $2 $3 $4: same edges as a single sweep"
+	fi
+done
+exit $status
@@ -0,0 +1,203 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include "threads.h"
+
+#include <unistd.h>
+
+#include "utils.h"
+
+// the range of the thread with the most indices left, NULL if none
+static threads_range_t* victim(threads_t* t)
+{
+	threads_range_t* ret = NULL;
+	size_t most = 0;
+	for (size_t i = 0; i < t->n_threads; i++)
+	{
+		threads_range_t* r = &t->ranges[i];
+		pthread_mutex_lock(&r->lock);
+		size_t left = r->end - r->next;
+		pthread_mutex_unlock(&r->lock);
+		if (left > most)
+		{
+			most = left;
+			ret = r;
+		}
+	}
+	return ret;
+}
+
+// run slices of the current loop from the range of the thread, then
+// from those stolen from others, until there are none left
+static void take_slices(threads_t* t, size_t thread)
+{
+	threads_range_t* own = &t->ranges[thread];
+	while (1)
+	{
+		pthread_mutex_lock(&own->lock);
+		if (own->next < own->end)
+		{
+			size_t a = own->next;
+			size_t b = a + t->chunk < own->end ? a + t->chunk : own->end;
+			own->next = b;
+			pthread_mutex_unlock(&own->lock);
+			t->f(t->arg, thread, a, b);
+			continue;
+		}
+		pthread_mutex_unlock(&own->lock);
+
+		threads_range_t* r = victim(t);
+		if (r == NULL)
+			return;
+
+		// may have been emptied meanwhile
+		pthread_mutex_lock(&r->lock);
+		size_t take = (r->end - r->next + 1) / 2;
+		size_t end = r->end;
+		r->end -= take;
+		pthread_mutex_unlock(&r->lock);
+
+		pthread_mutex_lock(&own->lock);
+		own->next = end - take;
+		own->end  = end;
+		pthread_mutex_unlock(&own->lock);
+	}
+}
+
+static void* worker(void* arg)
+{
+	threads_t* t = (threads_t*) arg;
+	size_t seen = 0;
+
+	pthread_mutex_lock(&t->lock);
+	size_t thread = ++t->n_started;
+	while (1)
+	{
+		while (!t->quit && t->round == seen)
+			pthread_cond_wait(&t->wake, &t->lock);
+		if (t->quit)
+			break;
+		seen = t->round;
+
+		pthread_mutex_unlock(&t->lock);
+		take_slices(t, thread);
+		pthread_mutex_lock(&t->lock);
+		if (--t->busy == 0)
+			pthread_cond_signal(&t->done);
+	}
+	pthread_mutex_unlock(&t->lock);
+	return NULL;
+}
+
+void threads_init(threads_t* t, size_t n_threads)
+{
+	if (n_threads == 0)
+	{
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		n_threads = n > 0 ? (size_t) n : 1;
+	}
+
+	t->n_threads = n_threads;
+	t->workers   = CALLOC(pthread_t, n_threads - 1);
+	t->ranges    = CALLOC(threads_range_t, n_threads);
+	for (size_t i = 0; i < n_threads; i++)
+	{
+		pthread_mutex_init(&t->ranges[i].lock, NULL);
+		t->ranges[i].next = 0;
+		t->ranges[i].end  = 0;
+	}
+
+	pthread_mutex_init(&t->lock, NULL);
+	pthread_cond_init(&t->wake, NULL);
+	pthread_cond_init(&t->done, NULL);
+
+	t->f     = NULL;
+	t->arg   = NULL;
+	t->chunk = 1;
+	t->busy  = 0;
+	t->round = 0;
+	t->quit  = 0;
+
+	t->n_started = 0;
+
+	for (size_t i = 0; i < n_threads - 1; i++)
+	{
+		if (pthread_create(&t->workers[i], NULL, worker, t) != 0)
+		{
+			fprintf(stderr, "Could not start worker thread\n");
+			exit(1);
+		}
+	}
+}
+
+void threads_exit(threads_t* t)
+{
+	pthread_mutex_lock(&t->lock);
+	t->quit = 1;
+	pthread_cond_broadcast(&t->wake);
+	pthread_mutex_unlock(&t->lock);
+
+	for (size_t i = 0; i < t->n_threads - 1; i++)
+		pthread_join(t->workers[i], NULL);
+	free(t->workers);
+
+	for (size_t i = 0; i < t->n_threads; i++)
+		pthread_mutex_destroy(&t->ranges[i].lock);
+	free(t->ranges);
+
+	pthread_cond_destroy(&t->done);
+	pthread_cond_destroy(&t->wake);
+	pthread_mutex_destroy(&t->lock);
+}
+
+void threads_run(threads_t* t, size_t n, void (*f)(void*, size_t, size_t, size_t), void* arg)
+{
+	if (t->n_threads == 1 || n == 0)
+	{
+		if (n != 0)
+			f(arg, 0, 0, n);
+		return;
+	}
+
+	// a few slices per thread to even out the load
+	size_t chunk = n / (8 * t->n_threads);
+
+	pthread_mutex_lock(&t->lock);
+	t->f     = f;
+	t->arg   = arg;
+	t->chunk = chunk != 0 ? chunk : 1;
+	for (size_t i = 0; i < t->n_threads; i++)
+	{
+		threads_range_t* r = &t->ranges[i];
+		pthread_mutex_lock(&r->lock);
+		r->next = i * n / t->n_threads;
+		r->end  = (i+1) * n / t->n_threads;
+		pthread_mutex_unlock(&r->lock);
+	}
+	t->busy  = t->n_threads - 1;
+	t->round++;
+	pthread_cond_broadcast(&t->wake);
+	pthread_mutex_unlock(&t->lock);
+
+	take_slices(t, 0);
+
+	pthread_mutex_lock(&t->lock);
+	while (t->busy != 0)
+		pthread_cond_wait(&t->done, &t->lock);
+	pthread_mutex_unlock(&t->lock);
+}
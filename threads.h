@@ -0,0 +1,72 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#ifndef THREADS_H
+#define THREADS_H
+
+typedef struct threads threads_t;
+
+#include <sys/types.h>
+#include <pthread.h>
+
+// the part of the current loop left to a thread
+typedef struct threads_range threads_range_t;
+struct threads_range
+{
+	pthread_mutex_t lock;
+	size_t          next; // first index not handed out yet
+	size_t          end;
+};
+
+// a set of worker threads running parallel loops; the calling thread
+// takes part in the loops, so a set of one thread runs them serially
+struct threads
+{
+	size_t     n_threads; // including the caller
+	pthread_t* workers;
+
+	pthread_mutex_t lock;
+	pthread_cond_t  wake;
+	pthread_cond_t  done;
+
+	size_t n_started; // workers that took their index
+
+	// current loop
+	void  (*f)(void* arg, size_t thread, size_t a, size_t b);
+	void*   arg;
+	size_t  chunk;
+	threads_range_t* ranges; // one per thread
+	size_t  busy;  // workers not done with the loop
+	size_t  round; // loops started so far
+	char    quit;
+};
+
+// n_threads == 0 means one per online processor
+void threads_init(threads_t* t, size_t n_threads);
+void threads_exit(threads_t* t);
+
+// call f(arg, i, a, b) on consecutive slices [a,b) covering [0,n)
+// and return once all of them are done; i < n_threads identifies the
+// thread running the slice (0 for the caller), e.g. to use scratch
+// space of its own
+//
+// each thread starts with an equal range of [0,n), and once done with
+// it steals the second half of what is left of the largest one
+void threads_run(threads_t* t, size_t n, void (*f)(void*, size_t, size_t, size_t), void* arg);
+
+#endif
@@ -24,7 +24,7 @@
 static inline void* check_alloc(size_t n, void* ptr, const char* file, int line)
 {
 	void* ret = realloc(ptr, n);
-	if (ret == NULL)
+	if (ret == NULL && n != 0)
 	{
 		fprintf(stderr, "Could not allocate memory at '%s' line %i\n", file, line);
 		exit(1);
@@ -19,17 +19,77 @@
 #include "voronoi.h"
 
 #include <string.h>
+#include <math.h>
 
 #include "utils.h"
 
-void vr_diagram_init(vr_diagram_t* v, double w, double h)
+static void* new_block(vr_diagram_t* v, size_t size)
+{
+	if (v->n_blocks == v->a_blocks)
+	{
+		v->a_blocks = v->a_blocks == 0 ? 16 : 2*v->a_blocks;
+		v->blocks = CREALLOC(v->blocks, void*, v->a_blocks);
+	}
+	void* b = CALLOC(char, size);
+	v->blocks[v->n_blocks++] = b;
+	return b;
+}
+
+// make room for n objects in each array
+static void reserve_vertices(vr_diagram_t* v, size_t n)
+{
+	if (n <= v->a_vertices)
+		return;
+	v->vertices = CREALLOC(v->vertices, vr_vertex_t*, n);
+	vr_vertex_t* b = new_block(v, (n - v->a_vertices) * sizeof(vr_vertex_t));
+	for (size_t i = v->a_vertices; i < n; i++)
+		v->vertices[i] = b++;
+	v->a_vertices = n;
+}
+static void reserve_edges(vr_diagram_t* v, size_t n)
+{
+	if (n <= v->a_edges)
+		return;
+	v->edges = CREALLOC(v->edges, vr_edge_t*, n);
+	vr_edge_t* b = new_block(v, (n - v->a_edges) * sizeof(vr_edge_t));
+	for (size_t i = v->a_edges; i < n; i++)
+		v->edges[i] = b++;
+	v->a_edges = n;
+}
+static void reserve_regions(vr_diagram_t* v, size_t n)
+{
+	if (n <= v->a_regions)
+		return;
+	v->regions = CREALLOC(v->regions, vr_region_t*, n);
+	vr_region_t* b = new_block(v, (n - v->a_regions) * sizeof(vr_region_t));
+	for (size_t i = v->a_regions; i < n; i++)
+		v->regions[i] = b++;
+	v->a_regions = n;
+}
+static void reserve_sites(vr_diagram_t* v, size_t n)
+{
+	if (n <= v->a_sites)
+		return;
+	v->a_sites   = n;
+	v->sites     = CREALLOC(v->sites,     vr_region_t*, n);
+	v->site_keys = CREALLOC(v->site_keys, double,       n);
+}
+
+void vr_diagram_init(vr_diagram_t* v, double w, double h, size_t n)
 {
 	v->width  = w;
 	v->height = h;
 
-	v->n_edges = 0;
-	v->a_edges = 0;
-	v->edges   = NULL;
+	v->n_edges  = 0;
+	v->a_edges  = 0;
+	v->edges    = NULL;
+	v->a_hedges = 0;
+	v->hedges   = NULL;
+
+	v->a_region_edges = 0;
+	v->region_edges   = NULL;
+	v->a_vertex_edges = 0;
+	v->vertex_edges   = NULL;
 
 	v->n_vertices = 0;
 	v->a_vertices = 0;
@@ -39,334 +99,1132 @@ void vr_diagram_init(vr_diagram_t* v, double w, double h)
 	v->a_regions = 0;
 	v->regions   = NULL;
 
+	v->n_blocks = 0;
+	v->a_blocks = 0;
+	v->blocks   = NULL;
+
+	v->n_sites      = 0;
+	v->a_sites      = 0;
+	v->c_sites      = 0;
+	v->sites        = NULL;
+	v->site_keys    = NULL;
+	v->sorted_sites = 1;
+	v->n_given      = 0;
+	radix_init(&v->sort);
+
+	v->source     = NULL;
+	v->source_arg = NULL;
+	v->source_x   = -HUGE_VAL;
+	v->source_end = 0;
+	v->unsorted   = 0;
+
 	heap_init(&v->events);
+	v->n_pool    = 1;
+	v->a_pool    = 0;
+	v->pool      = NULL;
+	v->pool_free = 0;
 	vr_binbeach_init(&v->front);
 	v->sweepline  = 0;
+	v->bounded    = 0;
+	v->bound_wait = 0;
+	v->stopped    = 0;
+
+	v->n_scratch = 0;
+	v->scratch   = NULL;
+
+	v->sink        = NULL;
+	v->sink_arg    = NULL;
+	v->n_crossings = 0;
+	v->a_crossings = 0;
+	v->crossings   = NULL;
+
+	v->a_breaks = 0;
+	v->breaks   = NULL;
+
+	v->n_cancelled   = 0;
+	v->n_rescheduled = 0;
+	v->n_skipped     = 0;
+
+	// a diagram of n sites has about 2n vertices and 3n edges, plus
+	// those added on the borders by clipping
+	if (n != 0)
+	{
+		size_t border = 4 * (size_t) sqrt(n) + 16;
+		reserve_regions (v, n);
+		reserve_sites   (v, n);
+		reserve_edges   (v, 3*n + border);
+		reserve_vertices(v, 2*n + border);
+	}
 }
 
 void vr_diagram_exit(vr_diagram_t* v)
 {
 	vr_binbeach_exit(&v->front);
 
-	vr_event_t* e;
-	while ((e = heap_remove(&v->events)) != NULL)
-		free(e);
 	heap_exit(&v->events);
+	free(v->pool);
+
+	for (size_t i = 0; i < v->n_blocks; i++)
+		free(v->blocks[i]);
+	free(v->blocks);
 
-	for (size_t i = 0; i < v->n_regions; i++)
-	{
-		vr_region_t* r = v->regions[i];
-		free(r->edges);
-		free(r);
-	}
 	free(v->regions);
+	free(v->sites);
+	free(v->site_keys);
+	radix_exit(&v->sort);
 
-	for (size_t i = 0; i < v->n_edges; i++)
-		free(v->edges[i]);
 	free(v->edges);
+	free(v->hedges);
+	free(v->vertices);
 
-	for (size_t i = 0; i < v->n_vertices; i++)
+	free(v->region_edges);
+	free(v->vertex_edges);
+	free(v->crossings);
+	free(v->breaks);
+
+	for (size_t i = 0; i < v->n_scratch; i++)
+		free(v->scratch[i].p);
+	free(v->scratch);
+}
+
+void vr_diagram_reset(vr_diagram_t* v)
+{
+	v->n_vertices = 0;
+	v->n_edges    = 0;
+	v->n_regions  = 0;
+
+	v->n_sites      = 0;
+	v->c_sites      = 0;
+	v->sorted_sites = 1;
+	v->n_given      = 0;
+	v->source_x     = -HUGE_VAL;
+	v->source_end   = 0;
+	v->unsorted     = 0;
+
+	heap_reset(&v->events);
+	v->n_pool    = 1;
+	v->pool_free = 0;
+	vr_binbeach_reset(&v->front);
+	v->sweepline  = 0;
+	v->bound_wait = 0;
+	v->stopped    = 0;
+
+	v->n_crossings = 0;
+
+	v->n_cancelled   = 0;
+	v->n_rescheduled = 0;
+	v->n_skipped     = 0;
+}
+
+vr_scratch_t* vr_diagram_scratch(vr_diagram_t* v, size_t n)
+{
+	if (n > v->n_scratch)
 	{
-		vr_vertex_t* p = v->vertices[i];
-		free(p->edges);
-		free(p);
+		v->scratch = CREALLOC(v->scratch, vr_scratch_t, n);
+		for (size_t i = v->n_scratch; i < n; i++)
+			v->scratch[i] = (vr_scratch_t){0, NULL};
+		v->n_scratch = n;
 	}
-	free(v->vertices);
+	return v->scratch;
 }
 
-void vr_diagram_point(vr_diagram_t* v, point_t p)
+point_t* vr_scratch_reserve(vr_scratch_t* s, size_t n)
+{
+	if (n > s->avail)
+	{
+		s->avail = n > 2*s->avail ? n : 2*s->avail;
+		s->p = CREALLOC(s->p, point_t, s->avail);
+	}
+	return s->p;
+}
+
+static vr_region_t* new_region(vr_diagram_t* v, point_t p)
 {
 	if (v->n_regions == v->a_regions)
+		reserve_regions(v, v->a_regions == 0 ? 64 : 2*v->a_regions);
+	vr_region_t* r = v->regions[v->n_regions];
+	*r = (vr_region_t){p, v->n_regions, v->n_given++, 0, NULL, NULL};
+	v->n_regions++;
+	return r;
+}
+// the region is moved past the used ones, to be reused
+static void release_region(vr_diagram_t* v, vr_region_t* r)
+{
+	vr_region_t* last = v->regions[--v->n_regions];
+	v->regions[r->id] = last;
+	last->id = r->id;
+	v->regions[v->n_regions] = r;
+	r->id = v->n_regions;
+}
+
+static uint32_t new_event(vr_diagram_t* v)
+{
+	uint32_t id = v->pool_free;
+	if (id != 0)
 	{
-		v->a_regions = v->a_regions == 0 ? 1 : 2*v->a_regions;
-		v->regions = CREALLOC(v->regions, vr_region_t*, v->a_regions);
+		v->pool_free = v->pool[id].next;
+		return id;
 	}
-	vr_region_t* r = CALLOC(vr_region_t, 1);
-	*r = (vr_region_t){p, 0, NULL};
-	v->regions[v->n_regions++] = r;
 
-	vr_event_t* e = CALLOC(vr_event_t, 1);
-	*e = (vr_event_t){0, 1, r, NULL, NULL};
-	heap_insert(&v->events, p.x, e);
+	if (v->n_pool >= v->a_pool)
+	{
+		v->a_pool = v->a_pool == 0 ? 64 : 2*v->a_pool;
+		v->pool = CREALLOC(v->pool, vr_event_t, v->a_pool);
+	}
+	return v->n_pool++;
+}
+
+static void free_event(vr_diagram_t* v, uint32_t id)
+{
+	v->pool[id].next = v->pool_free;
+	v->pool_free = id;
+}
+
+void vr_diagram_point(vr_diagram_t* v, point_t p)
+{
+	vr_region_t* r = new_region(v, p);
+
+	uint32_t id = new_event(v);
+	v->pool[id] = (vr_event_t){0, r, {0,0}, NULL, 0};
+	heap_insert(&v->events, p.x, id);
 }
 
-void vr_diagram_points(vr_diagram_t* v, size_t n, point_t* p)
+void vr_diagram_points(vr_diagram_t* v, size_t n, const point_t* p)
 {
+	reserve_sites(v, v->n_sites + n);
+
 	for (; n; p++, n--)
-		vr_diagram_point(v, *p);
+		v->sites[v->n_sites++] = new_region(v, *p);
+	v->sorted_sites = 0;
 }
 
 static vr_vertex_t* new_vertex(vr_diagram_t* v)
 {
 	if (v->n_vertices == v->a_vertices)
+		reserve_vertices(v, v->a_vertices == 0 ? 64 : 2*v->a_vertices);
+	vr_vertex_t* np = v->vertices[v->n_vertices];
+	*np = (vr_vertex_t) {{0,0}, v->n_vertices, 0, NULL};
+	v->n_vertices++;
+	return np;
+}
+// schedule the circle event of arc n, of center p and radius r, or
+// cancel it when r is negative
+static void schedule(vr_diagram_t* v, vr_bnode_t* n, point_t p, double r)
+{
+	uint32_t id = n->event;
+	if (r < 0)
 	{
-		v->a_vertices = v->a_vertices == 0 ? 1 : 2*v->a_vertices;
-		v->vertices = CREALLOC(v->vertices, vr_vertex_t*, v->a_vertices);
+		// cancel the previous event
+		if (id != 0)
+		{
+			heap_delete(&v->events, id);
+			free_event(v, id);
+			n->event = 0;
+			v->n_cancelled++;
+		}
+		return;
 	}
-	vr_vertex_t* np = CALLOC(vr_vertex_t, 1);
-	*np = (vr_vertex_t) {{0,0}, 0, NULL};
-	v->vertices[v->n_vertices++] = np;
-	return np;
+
+	if (id != 0)
+	{
+		// reschedule the previous event
+		v->pool[id].c = p;
+		heap_update(&v->events, id, p.x + r);
+		v->n_rescheduled++;
+		return;
+	}
+
+	id = new_event(v);
+	v->pool[id] = (vr_event_t){1, n->r1, p, n, 0};
+	heap_insert(&v->events, p.x + r, id);
+	n->event = id;
 }
-static void push_circle(vr_diagram_t* v, vr_bnode_t* n)
+// refresh the circle events of arcs a and b (either may be NULL), the
+// circles through them and their neighbours being found in one batch
+static void push_circles(vr_diagram_t* v, vr_bnode_t* a, vr_bnode_t* b)
 {
-	if (n->event != NULL)
-		n->event->active = 0;
-	n->event = NULL;
+	vr_bnode_t* arcs[2] = {a, b};
+	double x[3][2], y[3][2];
+	double cx[2], cy[2], r[2];
+	size_t k[2]; // triple of each arc, 2 for none
+	size_t n = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		vr_bnode_t* pa = arcs[i] != NULL ? vr_bnode_prev(arcs[i]) : NULL;
+		vr_bnode_t* na = arcs[i] != NULL ? vr_bnode_next(arcs[i]) : NULL;
+		k[i] = 2;
+		if (pa == NULL || na == NULL)
+			continue;
+		// (most triples turn the wrong way, which is cheap to tell)
+		point_t p1 = pa->r1->p, p2 = arcs[i]->r1->p, p3 = na->r1->p;
+		if ((p2.x-p1.x)*(p3.y-p1.y) - (p3.x-p1.x)*(p2.y-p1.y) > 0)
+			continue;
+		x[0][n] = p1.x; y[0][n] = p1.y;
+		x[1][n] = p2.x; y[1][n] = p2.y;
+		x[2][n] = p3.x; y[2][n] = p3.y;
+		k[i] = n++;
+	}
+	circle_from3_n(n, cx, cy, r, x[0], y[0], x[1], y[1], x[2], y[2]);
+	for (int i = 0; i < 2; i++)
+		if (arcs[i] != NULL)
+		{
+			size_t j = k[i];
+			if (j == 2)
+				schedule(v, arcs[i], (point_t){0, 0}, -1);
+			else
+				schedule(v, arcs[i], (point_t){cx[j], cy[j]}, r[j]);
+		}
+}
 
-	// find previous and next arcs
-	vr_bnode_t* pa = vr_bnode_prev(n);
-	vr_bnode_t* na = vr_bnode_next(n);
+// edge between regions a and b, on the left and on the right of the
+// edge going from s.a to s.b: a breakpoint has the region of the arc
+// after it on its left as it moves, so the edges traced by one from a
+// vertex, or away from another, get the regions in that order
+static vr_edge_t* new_edge(vr_diagram_t* v, vr_region_t* a, vr_region_t* b)
+{
+	if (v->n_edges == v->a_edges)
+		reserve_edges(v, v->a_edges == 0 ? 64 : 2*v->a_edges);
 
-	if (pa == NULL || na == NULL)
-		return;
+	vr_edge_t* e = v->edges[v->n_edges];
+	*e = (vr_edge_t){{NULL, NULL}, a, b, v->n_edges};
+	v->n_edges++;
+	return e;
+}
+// where the bisector of edge e crosses side k of the box; it only
+// depends on the two sites (and not on their order), unlike the
+// intersection with the segment, whose ends depend on the other sites
+static void crossing(vr_diagram_t* v, vr_edge_t* e, size_t k, point_t* p)
+{
+	point_t a = e->ra->p;
+	point_t b = e->rb->p;
+	point_t m = {(a.x + b.x) / 2, (a.y + b.y) / 2};
+	point_t d = {a.y - b.y, b.x - a.x};
+
+	if (k % 2 == 0) // vertical side
+	{
+		double x = k == 0 ? 0 : v->width;
+		p->x = x;
+		p->y = m.y + (x - m.x) / d.x * d.y;
+	}
+	else
+	{
+		double y = k == 1 ? v->height : 0;
+		p->x = m.x + (y - m.y) / d.y * d.x;
+		p->y = y;
+	}
+}
 
-	point_t p;
-	double r;
-	if (!circle_from3(&p, &r, &pa->r1->p, &n->r1->p, &na->r1->p))
+// streaming: release e, and its ends once no other edge uses them (they
+// are moved past the used ones, to be reused)
+static void release_vertex(vr_diagram_t* v, point_t* p)
+{
+	vr_vertex_t* q = (vr_vertex_t*) p;
+	if (--q->n_edges != 0)
 		return;
+	vr_vertex_t* last = v->vertices[--v->n_vertices];
+	v->vertices[q->id] = last;
+	last->id = q->id;
+	v->vertices[v->n_vertices] = q;
+	q->id = v->n_vertices;
+}
+static void release_edge(vr_diagram_t* v, vr_edge_t* e)
+{
+	release_vertex(v, e->s.a);
+	release_vertex(v, e->s.b);
 
-	vr_event_t* e = CALLOC(vr_event_t, 1);
-	e->active = 1;
-	e->r = n->r1;
+	vr_edge_t* last = v->edges[--v->n_edges];
+	v->edges[e->id] = last;
+	last->id = e->id;
+	v->edges[v->n_edges] = e;
+	e->id = v->n_edges;
+}
+// parameter of end p of an edge on the bisector m + t d of its sites; an
+// end that is not finite is at infinity, on the side where it went
+static double end_param(const point_t* p, point_t m, point_t d)
+{
+	double t = ((p->x - m.x) * d.x + (p->y - m.y) * d.y) / (d.x*d.x + d.y*d.y);
+	if (isnan(t)) // infinite along both axes, or not a number
+		t = (p->x < m.x) == (d.x < 0) ? HUGE_VAL : -HUGE_VAL;
+	return t;
+}
+// clip edge e to the box into [a,b] (Liang-Barsky); k[i] is the side
+// where end i was moved (-1 if it was not); returns 0 if nothing is left
+//
+// the edge is clipped as the part of the bisector of its sites between
+// the parameters of its ends, rather than as the segment between them,
+// so that ends traced very far (between sites of nearly the same
+// abscissa) or to infinity (of the same abscissa) are handled in the
+// same pass, and that the box is not lost to rounding along a segment
+// much longer than it
+static char clip(vr_diagram_t* v, vr_edge_t* e, point_t* a, point_t* b, int k[2])
+{
+	point_t ra = e->ra->p;
+	point_t rb = e->rb->p;
+	point_t m = {(ra.x + rb.x) / 2, (ra.y + rb.y) / 2};
+	point_t d = {ra.y - rb.y, rb.x - ra.x};
+	if (d.x == 0 && d.y == 0)
+		return 0;
 
-	e->p = new_vertex(v);
-	e->p->p = p;
+	// end a is at t0 and end b at t1, along d or -d
+	double t0 = end_param(e->s.a, m, d);
+	double t1 = end_param(e->s.b, m, d);
+	if (t0 > t1)
+	{
+		d  = (point_t){-d.x, -d.y};
+		t0 = -t0;
+		t1 = -t1;
+	}
+
+	// m + t d is inside side i when p[i] t <= q[i]
+	double p[4] = {-d.x, d.y, d.x, -d.y};
+	double q[4] = {m.x, v->height - m.y, v->width - m.x, m.y};
 
-	e->is_circle = 1;
-	e->n = n;
-	heap_insert(&v->events, e->p->p.x + r, e);
-	n->event = e;
+	k[0] = -1;
+	k[1] = -1;
+	for (int i = 0; i < 4; i++)
+	{
+		if (p[i] == 0)
+		{
+			if (q[i] < 0)
+				return 0;
+			continue;
+		}
+		double t = q[i] / p[i];
+		if (p[i] < 0 && t > t0)
+		{
+			t0 = t;
+			k[0] = i;
+		}
+		else if (p[i] > 0 && t < t1)
+		{
+			t1 = t;
+			k[1] = i;
+		}
+	}
+
+	// edges of no length are kept inside the box, where they link the
+	// vertices of cocircular sites
+	if (t0 > t1 || (t0 == t1 && (k[0] >= 0 || k[1] >= 0)))
+		return 0;
+
+	*a = *e->s.a;
+	*b = *e->s.b;
+	if (k[0] >= 0)
+		crossing(v, e, k[0], a);
+	if (k[1] >= 0)
+		crossing(v, e, k[1], b);
+	return 1;
 }
+static void push_crossing(vr_diagram_t* v, vr_edge_t* e, int k, point_t p, point_t** end)
+{
+	double w = v->width;
+	double h = v->height;
+	double pos =
+		k == 0 ? p.y :
+		k == 1 ? h + p.x :
+		k == 2 ? h + w + (h - p.y) :
+		2*h + w + (w - p.x);
 
-static void region_addEdge(vr_region_t* a, vr_edge_t* e)
+	if (v->n_crossings == v->a_crossings)
+	{
+		v->a_crossings = v->a_crossings == 0 ? 64 : 2*v->a_crossings;
+		v->crossings = CREALLOC(v->crossings, vr_crossing_t, v->a_crossings);
+	}
+	v->crossings[v->n_crossings++] = (vr_crossing_t){pos, p, end, e->ra->p, e->rb->p, e->ra->site, e->rb->site};
+}
+// streaming: pass e to the sink if both its ends are known
+static void closed(vr_diagram_t* v, vr_edge_t* e)
 {
-	a->edges = CREALLOC(a->edges, vr_edge_t*, a->n_edges+1);
-	a->edges[a->n_edges++] = e;
+	if (e->s.a == NULL || e->s.b == NULL)
+		return;
+
+	point_t a, b;
+	int k[2];
+	if (clip(v, e, &a, &b, k))
+	{
+		v->sink(v->sink_arg, &a, &b, e->ra->site, e->rb->site);
+		if (k[0] >= 0)
+			push_crossing(v, e, k[0], a, NULL);
+		if (k[1] >= 0)
+			push_crossing(v, e, k[1], b, NULL);
+	}
+	release_edge(v, e);
 }
-static vr_edge_t* new_edge(vr_diagram_t* v, vr_region_t* a, vr_region_t* b)
+// the breakpoints between the arcs of the first sites, which share an
+// abscissa, trace edges that come from infinity on the left; a new
+// breakpoint starts one, and the one that was next to the new arc
+// keeps its edge, for its new regions
+static void start_ray(vr_diagram_t* v, vr_bnode_t* n)
 {
-	if (v->n_edges == v->a_edges)
+	vr_edge_t* f = n->edge;
+	if (f != NULL)
 	{
-		v->a_edges = v->a_edges == 0 ? 1 : 2*v->a_edges;
-		v->edges = CREALLOC(v->edges, vr_edge_t*, v->a_edges);
+		f->ra = n->r2;
+		f->rb = n->r1;
+		return;
 	}
 
-	vr_edge_t* e = CALLOC(vr_edge_t, 1);
-	*e = (vr_edge_t){{NULL, NULL}, a, b};
-	if (a != NULL) region_addEdge(a, e);
-	if (b != NULL) region_addEdge(b, e);
+	vr_vertex_t* p = new_vertex(v);
+	p->p = (point_t){-HUGE_VAL, (n->r1->p.y + n->r2->p.y) / 2};
+	p->n_edges = 1;
 
-	v->edges[v->n_edges++] = e;
-	return e;
+	f = new_edge(v, n->r2, n->r1);
+	f->s.a  = &p->p;
+	n->end  = &f->s.b;
+	n->edge = f;
 }
-char vr_diagram_step(vr_diagram_t* v)
+static void site_event(vr_diagram_t* v, vr_region_t* r)
 {
-	double idx = 0;
-	if (v->events.size != 0)
-		idx = v->events.tree[0].idx;
+	vr_bnode_t* n = vr_binbeach_breakAt(&v->front, v->sweepline, r);
+	r->n_edges++;
 
-	vr_event_t* e = heap_remove(&v->events);
-	if (e == NULL)
-		return 0;
+	// previous and next arcs
+	vr_bnode_t* pa = vr_bnode_prev(n);
+	vr_bnode_t* na = vr_bnode_next(n);
 
-	if (!e->active)
+	if (pa == NULL && na == NULL)
+		return;
+
+	// the arc of a site on the sweepline was not split
+	if (pa == NULL || na == NULL || pa->r1 != na->r1)
 	{
-		free(e);
-		return 1;
+		push_circles(v, pa, na);
+		if (pa != NULL)
+			start_ray(v, n->lbreak);
+		if (na != NULL)
+			start_ray(v, n->rbreak);
+		return;
 	}
 
-	v->sweepline = idx;
+	// the arc above was split in two
+	pa->r1->n_edges++;
+
+	// insert events
+	push_circles(v, pa, na);
+
+	// add edge
+	vr_edge_t* f = new_edge(v, pa->r1, r);
+	n->lbreak->end  = &f->s.a;
+	n->lbreak->edge = f;
+	n->rbreak->end  = &f->s.b;
+	n->rbreak->edge = f;
+}
+static void circle_event(vr_diagram_t* v, vr_event_t* e)
+{
+	// current arc
+	vr_bnode_t* n = e->n;
+
+	// new vertex, shared by three edges
+	vr_vertex_t* p = new_vertex(v);
+	p->p = e->c;
+	p->n_edges = 3;
 
-	if (e->is_circle)
+	// finish edges at breakpoints
+	*n->lbreak->end = &p->p;
+	*n->rbreak->end = &p->p;
+	if (v->sink != NULL)
 	{
-		// current arc
-		vr_bnode_t* n = e->n;
+		closed(v, n->lbreak->edge);
+		closed(v, n->rbreak->edge);
+	}
 
-		// finish edges at breakpoints
-		vr_bnode_t* lb = vr_bnode_right(n);
-		vr_bnode_t* rb = vr_bnode_left (n);
-		*lb->end = &e->p->p;
-		*rb->end = &e->p->p;
+	// save previous and next arcs
+	vr_bnode_t* pa = vr_bnode_prev(n);
+	vr_bnode_t* na = vr_bnode_next(n);
 
-		// save previous and next arcs
-		vr_bnode_t* pa = vr_bnode_prev(n);
-		vr_bnode_t* na = vr_bnode_next(n);
+	// remove arc, and its region with its last arc when streaming
+	// from a source (its edges are all closed)
+	vr_region_t* r = n->r1;
+	n = vr_bnode_remove(&v->front, n);
+	if (--r->n_edges == 0 && v->sink != NULL && v->source != NULL)
+		release_region(v, r);
 
-		// remove arc
-		n = vr_bnode_remove(n);
+	// refresh circle events
+	push_circles(v, pa, na);
+
+	// start new edge
+	vr_edge_t* f = new_edge(v, na->r1, pa->r1);
+	f->s.a = &p->p;
+	n->end  = &f->s.b;
+	n->edge = f;
+}
+#define VR_PULL 256
 
-		// refresh circle events
-		push_circle(v, pa);
-		push_circle(v, na);
+// replace the sites already swept by the next ones of the source; the
+// source is dropped, and the sweep stopped, at the first site out of order
+static void pull_sites(vr_diagram_t* v)
+{
+	v->n_sites = 0;
+	v->c_sites = 0;
 
-		// start new edge
-		vr_edge_t* f = new_edge(v, pa->r1, na->r1);
-		f->s.a = &e->p->p;
-		n->end = &f->s.b;
+	point_t p[VR_PULL];
+	size_t n = v->source(v->source_arg, p, VR_PULL);
+	if (n == 0)
+	{
+		v->source_end = 1;
+		return;
 	}
-	else
+
+	reserve_sites(v, n);
+	for (size_t i = 0; i < n; i++)
 	{
-		vr_bnode_t* n = vr_binbeach_breakAt(&v->front, v->sweepline, e->r);
+		if (p[i].x < v->source_x)
+		{
+			v->source_end = 1;
+			v->unsorted   = 1;
+			return;
+		}
+		v->source_x = p[i].x;
+		v->sites[v->n_sites++] = new_region(v, p[i]);
+	}
+}
+static vr_region_t* next_site(vr_diagram_t* v)
+{
+	if (v->c_sites == v->n_sites && v->source != NULL && !v->source_end)
+		pull_sites(v);
+
+	if (v->c_sites == v->n_sites)
+		return NULL;
+
+	// sort the sites not swept yet
+	if (!v->sorted_sites)
+	{
+		size_t n = v->n_sites - v->c_sites;
+		vr_region_t** sites = v->sites + v->c_sites;
+		double* keys = v->site_keys;
+		for (size_t i = 0; i < n; i++)
+			keys[i] = sites[i]->p.x;
+		radix_sort(&v->sort, n, keys, (void**) sites);
+		v->sorted_sites = 1;
+	}
+
+	return v->sites[v->c_sites];
+}
+// abscissa of the parabola of focus f and directrix x = l at ordinate y
+static double arc_x(point_t f, double l, double y)
+{
+	double t = y - f.y;
+	return (f.x + l) / 2 - t*t / (2 * (l - f.x));
+}
+
+// whether the beachline lies right of the box all along it; each point
+// of the box is then closer to a swept site than to the sweepline, so
+// that no site left can own it and no circle left can be centered in
+// it; the breakpoints are on the beachline, out of the box, and so are
+// the parts of the edges still to be traced, beyond them; the sweepline
+// is then moved where the beachline was looked at
+static char past_box(vr_diagram_t* v)
+{
+	// the beachline is looked at as far as it goes unchanged, short of
+	// the directrix that vr_diagram_end() would close it with
+	double l = vr_diagram_next(v);
+	double far = fmax(v->sweepline, v->width) + v->width + v->height;
+	if (l <= v->width || v->front.head == NULL)
+		return 0;
+
+	// the walk is paid for by as many steps before the next one, but is
+	// not put off past a jump of the sweepline, where it is the most
+	// likely to succeed
+	if (far < l)
+		l = far;
+	else if (v->bound_wait != 0)
+	{
+		v->bound_wait--;
+		return 0;
+	}
+	v->bound_wait = 0;
+
+	// an arc is concave, it is left-most at an end of the part of it
+	// over the box
+	double lo = -HUGE_VAL;
+	for (vr_bnode_t* a = v->front.head; a != NULL; a = a->next)
+	{
+		v->bound_wait++;
 
-		if (n->left == NULL)
+		double hi = HUGE_VAL;
+		if (a->next != NULL)
 		{
-			free(e);
-			return 1;
+			point_t p;
+			if (!parabola_intersect(&p, &a->rbreak->r1->p, &a->rbreak->r2->p, l) || isnan(p.y))
+				return 0;
+			hi = p.y;
 		}
 
-		// insert events
-		push_circle(v, n->left);
-		push_circle(v, n->right->right);
+		// the breakpoints of an arc still on the sweepline could not
+		// be traced
+		point_t f = a->r1->p;
+		if (f.x >= l)
+			return 0;
 
-		// add edge
-		vr_edge_t* f = new_edge(v, n->r1, e->r);
-		n       ->end = &f->s.a;
-		n->right->end = &f->s.b;
+		double y0 = lo > 0 ? lo : 0;
+		double y1 = hi < v->height ? hi : v->height;
+		if (y0 <= y1 && (arc_x(f, l, y0) <= v->width || arc_x(f, l, y1) <= v->width))
+			return 0;
+		lo = hi;
 	}
 
-	free(e);
+	v->sweepline = l;
+	v->stopped   = 1;
+	v->n_skipped = v->events.size + (v->n_sites - v->c_sites);
 	return 1;
 }
 
-static void finishEdges(vr_diagram_t* v, vr_bnode_t* n)
+char vr_diagram_step(vr_diagram_t* v)
 {
-	if (n->left == NULL)
+	if (v->stopped || (v->bounded && past_box(v)))
+		return 0;
+
+	// the next site is swept before any event at the same abscissa
+	vr_region_t* r = next_site(v);
+	if (v->unsorted)
+		return 0;
+	if (r != NULL && (v->events.size == 0 || r->p.x <= v->events.tree[0].idx))
+	{
+		v->c_sites++;
+		v->sweepline = r->p.x;
+		site_event(v, r);
+		return 1;
+	}
+
+	if (v->events.size == 0)
+		return 0;
+
+	v->sweepline = v->events.tree[0].idx;
+
+	// copy the record, the pool may move while it is processed
+	uint32_t id = heap_remove(&v->events);
+	vr_event_t e = v->pool[id];
+	free_event(v, id);
+
+	if (e.is_circle)
+		circle_event(v, &e);
+	else
+		site_event(v, e.r);
+
+	return 1;
+}
+
+double vr_diagram_next(vr_diagram_t* v)
+{
+	double x = v->events.size != 0 ? v->events.tree[0].idx : HUGE_VAL;
+	vr_region_t* r = next_site(v);
+	return r != NULL && r->p.x < x ? r->p.x : x;
+}
+
+// close the edges of the breakpoints left, walking the arcs in order
+static void finishEdges(vr_diagram_t* v)
+{
+	vr_bnode_t* head = v->front.head;
+	if (head == NULL)
 		return;
 
-	vr_vertex_t* p = new_vertex(v);
-	parabola_intersect(&p->p, &n->r1->p, &n->r2->p, v->sweepline);
-	*n->end = &p->p;
+	size_t n = 0;
+	for (vr_bnode_t* a = head; a->next != NULL; a = a->next)
+		n++;
+
+	if (6*n > v->a_breaks)
+	{
+		v->a_breaks = 6*n;
+		v->breaks = CREALLOC(v->breaks, double, v->a_breaks);
+	}
+	double* x1 = v->breaks;
+	double* y1 = x1 + n;
+	double* x2 = y1 + n;
+	double* y2 = x2 + n;
+	double* x  = y2 + n;
+	double* y  = x  + n;
 
-	finishEdges(v, n->left);
-	finishEdges(v, n->right);
+	// all the breakpoints are found in one batch
+	vr_bnode_t* a = head;
+	for (size_t i = 0; i < n; i++, a = a->next)
+	{
+		x1[i] = a->rbreak->r1->p.x;
+		y1[i] = a->rbreak->r1->p.y;
+		x2[i] = a->rbreak->r2->p.x;
+		y2[i] = a->rbreak->r2->p.y;
+	}
+	parabola_intersect_n(n, x, y, x1, y1, x2, y2, v->sweepline);
+
+	// then linked; when streaming, an edge is closed once both its ends
+	// are set, which happens once even if two breakpoints trace it
+	a = head;
+	for (size_t i = 0; i < n; i++, a = a->next)
+	{
+		vr_vertex_t* p = new_vertex(v);
+		p->p = (point_t){x[i], y[i]};
+		p->n_edges = 1;
+		*a->rbreak->end = &p->p;
+		if (v->sink != NULL)
+			closed(v, a->rbreak->edge);
+	}
 }
-static char inRect(vr_diagram_t* v, point_t* p)
+static vr_hedge_t* region_hedge(vr_diagram_t* v, vr_region_t* r, vr_edge_t* e)
 {
-	return
-	0 < p->x && p->x < v->width  &&
-	0 < p->y && p->y < v->height &&
-	1;
+	vr_hedge_t* h = &v->hedges[2*e->id];
+	return h->r == r ? h : h->twin;
 }
-static void vr_diagram_restrictRegion(vr_diagram_t* v, vr_region_t* r)
+// the boundary of r is closed when its half-edges form a single cycle
+static void close_region(vr_diagram_t* v, vr_region_t* r)
 {
-	point_t corners[4] =
+	r->hedge = NULL;
+	size_t n = r->n_edges;
+	if (n == 0)
+		return;
+
+	vr_hedge_t* h0 = region_hedge(v, r, r->edges[0]);
+	vr_hedge_t* h = h0;
+	size_t k = 0;
+	do
+	{
+		h = h->next;
+		k++;
+	} while (h != NULL && h != h0 && k <= n);
+
+	if (h == h0 && k == n)
+		r->hedge = h0;
+}
+static void vr_diagram_link(vr_diagram_t* v)
+{
+	if (2*v->n_edges > v->a_hedges)
 	{
-		{       0,        0},
-		{       0,v->height},
-		{v->width,v->height},
-		{v->width,        0},
-	};
-	segment_t border[4] =
+		v->a_hedges = 2*v->n_edges;
+		v->hedges = CREALLOC(v->hedges, vr_hedge_t, v->a_hedges);
+	}
+	point_t center = {v->width / 2, v->height / 2};
+	for (size_t i = 0; i < v->n_edges; i++)
 	{
-		{&corners[0], &corners[1]},
-		{&corners[1], &corners[2]},
-		{&corners[2], &corners[3]},
-		{&corners[3], &corners[0]},
-	};
+		vr_edge_t* e = v->edges[i];
+		vr_hedge_t* h0 = &v->hedges[2*i];
+		vr_hedge_t* h1 = &v->hedges[2*i+1];
 
-	// find two jutting edges
-	point_t* a = NULL;
-	point_t* b = NULL;
-	for (ssize_t j = 0; j < (ssize_t) r->n_edges; j++)
+		// h0 goes from a to b, and ra is on its left (see new_edge());
+		// the sides of a border edge, whose site may be outside, are
+		// found from the box, which is always on the side of ra
+		point_t ab = point_minus(*e->s.b, *e->s.a);
+		point_t as = point_minus(e->rb != NULL ? e->ra->p : center, *e->s.a);
+		char left = e->rb != NULL || point_cross(ab, as) > 0;
+
+		*h0 = (vr_hedge_t){e->s.a, e->s.b, left ? e->ra : e->rb, e, h1, NULL, NULL};
+		*h1 = (vr_hedge_t){e->s.b, e->s.a, left ? e->rb : e->ra, e, h0, NULL, NULL};
+	}
+
+	// each half-edge is followed by the one of its region starting at
+	// the vertex where it ends; going through them in the order of the
+	// edges, rather than region by region, keeps the accesses close
+	for (size_t i = 0; i < 2*v->n_edges; i++)
 	{
-		vr_edge_t* e = r->edges[j];
-		char ak = inRect(v, e->s.a);
-		char bk = inRect(v, e->s.b);
+		vr_hedge_t* h = &v->hedges[i];
+		if (h->r == NULL)
+			continue;
 
-		if (!ak && !bk) // outside edge
-		{
-			r->n_edges--;
-			memmove(r->edges+j, r->edges+j+1, sizeof(vr_edge_t*)*(r->n_edges-j));
-			j--;
-		}
-		else if (ak != bk) // jutting edge
+		vr_vertex_t* q = (vr_vertex_t*) h->b;
+		for (size_t j = 0; j < q->n_edges; j++)
 		{
-			point_t* p = !ak ? e->s.a : e->s.b;
-			if (a == NULL) // first jutting edge
-			{
-				// TODO
-				// BEGIN quickfix
-				// this edge might share its end with the other
-				// jutting edge; we need to split this end
-				vr_vertex_t* np = new_vertex(v);
-				np->p = *p;
-				p = &np->p;
-				if (!ak) e->s.a = p;
-				else e->s.b = p;
-				// END quickfix
-
-				a = p;
-			}
-			else // second jutting edge
+			vr_edge_t* e = q->edges[j];
+			if (e == h->e || (e->ra != h->r && e->rb != h->r))
+				continue;
+			vr_hedge_t* c = region_hedge(v, h->r, e);
+			if (c->a == h->b && c->prev == NULL)
 			{
-				b = p;
+				h->next = c;
+				c->prev = h;
+				break;
 			}
+		}
+	}
+
+	for (size_t i = 0; i < v->n_regions; i++)
+		close_region(v, v->regions[i]);
+}
+// fill the edge lists of the regions (and of the vertices if asked)
+// as slices of one array each: count, compute offsets, then fill
+static void vr_diagram_index(vr_diagram_t* v, char vertices)
+{
+	for (size_t i = 0; i < v->n_regions; i++)
+		v->regions[i]->n_edges = 0;
+	if (vertices)
+		for (size_t i = 0; i < v->n_vertices; i++)
+			v->vertices[i]->n_edges = 0;
 
-			// crop the edge
-			for (size_t k = 0; k < 4 && !segment_intersect(p, &border[k], &e->s); k++);
+	// count
+	for (size_t i = 0; i < v->n_edges; i++)
+	{
+		vr_edge_t* e = v->edges[i];
+		e->ra->n_edges++;
+		if (e->rb != NULL)
+			e->rb->n_edges++;
+		if (vertices)
+		{
+			((vr_vertex_t*) e->s.a)->n_edges++;
+			((vr_vertex_t*) e->s.b)->n_edges++;
 		}
 	}
 
-	if (a == NULL || b == NULL)
-		return;
+	// slice
+	if (2*v->n_edges > v->a_region_edges)
+	{
+		v->a_region_edges = 2*v->n_edges;
+		v->region_edges = CREALLOC(v->region_edges, vr_edge_t*, v->a_region_edges);
+	}
+	vr_edge_t** next = v->region_edges;
+	for (size_t i = 0; i < v->n_regions; i++)
+	{
+		vr_region_t* r = v->regions[i];
+		r->edges = next;
+		next += r->n_edges;
+		r->n_edges = 0;
+	}
+	if (vertices)
+	{
+		if (2*v->n_edges > v->a_vertex_edges)
+		{
+			v->a_vertex_edges = 2*v->n_edges;
+			v->vertex_edges = CREALLOC(v->vertex_edges, vr_edge_t*, v->a_vertex_edges);
+		}
+		next = v->vertex_edges;
+		for (size_t i = 0; i < v->n_vertices; i++)
+		{
+			vr_vertex_t* p = v->vertices[i];
+			p->edges = next;
+			next += p->n_edges;
+			p->n_edges = 0;
+		}
+	}
 
-	point_t p;
-	// handle sides
-	if (a->x == b->x || a->y == b->y)
+	// fill
+	for (size_t i = 0; i < v->n_edges; i++)
 	{
-		vr_edge_t* e = new_edge(v, r, NULL);
-		e->s.a = a;
-		e->s.b = b;
-		return;
+		vr_edge_t* e = v->edges[i];
+		e->ra->edges[e->ra->n_edges++] = e;
+		if (e->rb != NULL)
+			e->rb->edges[e->rb->n_edges++] = e;
+		if (vertices)
+		{
+			vr_vertex_t* a = (vr_vertex_t*) e->s.a;
+			vr_vertex_t* b = (vr_vertex_t*) e->s.b;
+			a->edges[a->n_edges++] = e;
+			b->edges[b->n_edges++] = e;
+		}
+	}
+}
+// clip all the edges to the box in a single pass; those left outside
+// are moved past the used ones, to be reused, and the ends moved to the
+// border get a vertex of their own (the old one may still be used)
+static void clipEdges(vr_diagram_t* v)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < v->n_edges; i++)
+	{
+		vr_edge_t* e = v->edges[i];
+		point_t a, b;
+		int k[2];
+		if (!clip(v, e, &a, &b, k))
+			continue;
+
+		if (k[0] >= 0)
+		{
+			vr_vertex_t* q = new_vertex(v);
+			q->p = a;
+			e->s.a = &q->p;
+			push_crossing(v, e, k[0], a, &e->s.a);
+		}
+		if (k[1] >= 0)
+		{
+			vr_vertex_t* q = new_vertex(v);
+			q->p = b;
+			e->s.b = &q->p;
+			push_crossing(v, e, k[1], b, &e->s.b);
+		}
+
+		e->id = n;
+		v->edges[i] = v->edges[n];
+		v->edges[n++] = e;
 	}
-	// handle corners (two sides)
-	else if ((a->x == 0 || a->x == v->width) && (b->y == 0 || b->y == v->height))
+	v->n_edges = n;
+}
+// remove the vertices no edge uses anymore (they are moved past the
+// used ones, to be reused)
+static void dropOrphans(vr_diagram_t* v)
+{
+	for (size_t i = 0; i < v->n_vertices; i++)
+		v->vertices[i]->n_edges = 0;
+	for (size_t i = 0; i < v->n_edges; i++)
 	{
-		p.x = a->x;
-		p.y = b->y;
+		vr_edge_t* e = v->edges[i];
+		((vr_vertex_t*) e->s.a)->n_edges++;
+		((vr_vertex_t*) e->s.b)->n_edges++;
 	}
-	else if ((a->y == 0 || a->y == v->height) && (b->x == 0 || b->x == v->width))
+
+	size_t n = 0;
+	for (size_t i = 0; i < v->n_vertices; i++)
 	{
-		p.x = b->x;
-		p.y = a->y;
+		vr_vertex_t* q = v->vertices[i];
+		if (q->n_edges == 0)
+			continue;
+		q->id = n;
+		v->vertices[i] = v->vertices[n];
+		v->vertices[n++] = q;
 	}
-	// should handle three or four sides
-	else
+	v->n_vertices = n;
+}
+static int cmp_crossing(const void* a, const void* b)
+{
+	double pa = ((const vr_crossing_t*) a)->pos;
+	double pb = ((const vr_crossing_t*) b)->pos;
+	return (pa > pb) - (pa < pb);
+}
+// border edge of region r from a to b; when building, it goes from
+// vertex pa to vertex pb, created if NULL, which is returned
+static point_t* borderEdge(vr_diagram_t* v, point_t a, point_t* pa, point_t b, point_t* pb, size_t r)
+{
+	if (v->sink != NULL)
+	{
+		v->sink(v->sink_arg, &a, &b, r, VR_NONE);
+		return NULL;
+	}
+
+	if (pb == NULL)
+	{
+		vr_vertex_t* q = new_vertex(v);
+		q->p = b;
+		pb = &q->p;
+	}
+	vr_edge_t* e = new_edge(v, v->regions[r], NULL);
+	e->s.a = pa;
+	e->s.b = pb;
+	return pb;
+}
+// walk along the border from corner (0,0), switching region at each
+// crossing, and add the border edges (split at the corners); when
+// building, they share the vertices of the clipped edges, and those
+// of crossings at the same position are merged (regions are not
+// released then, so a site is also the index of its region)
+static void border(vr_diagram_t* v)
+{
+	if (v->n_regions == 0)
 		return;
 
-	// apply common corner correction
-	vr_vertex_t* np = new_vertex(v);
-	np->p = p;
-	vr_edge_t* e1 = new_edge(v, r, NULL);
-	vr_edge_t* e2 = new_edge(v, r, NULL);
-	e1->s.a = a;
-	e1->s.b = &np->p;
-	e2->s.a = &np->p;
-	e2->s.b = b;
+	double w = v->width;
+	double h = v->height;
+	point_t corners[5] = {{0,0}, {0,h}, {w,h}, {w,0}, {0,0}};
+	double  ends[4]    = {h, h+w, 2*h+w, 2*h+2*w};
+	point_t dirs[4]    = {{0,1}, {1,0}, {0,-1}, {-1,0}};
+
+	size_t n = v->n_crossings;
+	vr_crossing_t* c = v->crossings;
+	if (n != 0) // c may be NULL then, which qsort() does not allow
+		qsort(c, n, sizeof(vr_crossing_t), cmp_crossing);
+
+	// the region before the first crossing; past a crossing, the
+	// site further along the side is the closest; without any, the
+	// box lies in a single cell, that of the closest site to a corner
+	size_t r = 0;
+	if (n != 0)
+	{
+		int k = 0;
+		while (k < 3 && c[0].pos > ends[k])
+			k++;
+		r = point_dot(c[0].sa, dirs[k]) < point_dot(c[0].sb, dirs[k]) ? c[0].ra : c[0].rb;
+	}
+	else
+	{
+		vr_region_t* best = v->regions[0];
+		for (size_t i = 1; i < v->n_regions; i++)
+			if (point_dot(v->regions[i]->p, v->regions[i]->p) < point_dot(best->p, best->p))
+				best = v->regions[i];
+		r = best->site;
+	}
+
+	// the vertex at corner (0,0), where the walk ends
+	point_t* origin = NULL;
+	if (v->sink == NULL)
+	{
+		vr_vertex_t* q = new_vertex(v);
+		q->p = corners[0];
+		origin = &q->p;
+	}
+
+	point_t  cur  = corners[0];
+	point_t* curp = origin;
+	size_t j = 0;
+	for (int k = 0; k < 4; k++)
+	{
+		for (; j < n && c[j].pos <= ends[k]; j++)
+		{
+			point_t  p  = c[j].p;
+			point_t* pp = NULL;
+			if (c[j].end != NULL)
+			{
+				if (p.x == 0 && p.y == 0)
+					*c[j].end = origin;
+				pp = *c[j].end;
+			}
+
+			if (cur.x != p.x || cur.y != p.y)
+			{
+				borderEdge(v, cur, curp, p, pp, r);
+				cur  = p;
+				curp = pp;
+			}
+			else if (pp != NULL)
+				*c[j].end = curp;
+			r = point_dot(c[j].sa, dirs[k]) > point_dot(c[j].sb, dirs[k]) ? c[j].ra : c[j].rb;
+		}
+		point_t p = corners[k+1];
+		if (cur.x != p.x || cur.y != p.y)
+		{
+			curp = borderEdge(v, cur, curp, p, k == 3 ? origin : NULL, r);
+			cur  = p;
+		}
+	}
 }
-void vr_diagram_end(vr_diagram_t* v)
+char vr_diagram_end(vr_diagram_t* v)
 {
 	while (vr_diagram_step(v));
+	if (v->unsorted)
+		return 0;
 
-	v->sweepline += 1000;
-	finishEdges(v, v->front.root);
+	// the breakpoints left are traced with a directrix far enough
+	// for them to be out of the box, whatever its size; when a bounded
+	// sweep stopped, they already are
+	if (!v->stopped)
+		v->sweepline = fmax(v->sweepline, v->width) + v->width + v->height;
+	finishEdges(v);
 
-	for (size_t i = 0; i < v->n_regions; i++)
-		vr_diagram_restrictRegion(v, v->regions[i]);
+	// when streaming, the edges were clipped as they were closed, and
+	// the regions keep no edges (their counts of arcs are reset)
+	if (v->sink != NULL)
+	{
+		border(v);
+		for (size_t i = 0; i < v->n_regions; i++)
+			v->regions[i]->n_edges = 0;
+		return 1;
+	}
+
+	clipEdges(v);
+	border(v);
+	dropOrphans(v);
+
+	vr_diagram_index(v, 1);
+	vr_diagram_link(v);
+	return 1;
 }
 
-static void vertex_addEdge(vr_vertex_t* p, vr_edge_t* e)
+void vr_diagram_stream(vr_diagram_t* v, vr_sink_t sink, void* arg)
 {
-	p->edges = CALLOC(vr_edge_t*, p->n_edges+1);
-	p->edges[p->n_edges++] = e;
+	v->sink     = sink;
+	v->sink_arg = arg;
 }
-void vr_diagram_fill(vr_diagram_t* v)
+
+void vr_diagram_bounded(vr_diagram_t* v, char bounded)
 {
-	for (size_t i = 0; i < v->n_edges; i++)
-	{
-		vr_edge_t* e = v->edges[i];
-		vertex_addEdge((vr_vertex_t*) e->s.a, e);
-		vertex_addEdge((vr_vertex_t*) e->s.b, e);
-	}
+	v->bounded = bounded;
+}
+
+void vr_diagram_source(vr_diagram_t* v, vr_source_t src, void* arg)
+{
+	v->source     = src;
+	v->source_arg = arg;
+	v->source_end = 0;
+	v->unsorted   = 0;
 }
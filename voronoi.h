@@ -21,21 +21,38 @@
 
 typedef struct vr_vertex   vr_vertex_t;
 typedef struct vr_edge vr_edge_t;
+typedef struct vr_hedge   vr_hedge_t;
 typedef struct vr_region  vr_region_t;
 typedef struct vr_event   vr_event_t;
+typedef struct vr_scratch vr_scratch_t;
+typedef struct vr_crossing vr_crossing_t;
 typedef struct vr_diagram vr_diagram_t;
 
 #include "heap.h"
+#include "radix.h"
 #include "geometry.h"
 #include "binbeach.h"
 
+// region id of the outside of the box
+#define VR_NONE SIZE_MAX
+
+// receives the streamed edges (see vr_diagram_stream())
+typedef void (*vr_sink_t)(void* arg, const point_t* a, const point_t* b, size_t ra, size_t rb);
+
+// gives up to n more sites, in abscissa order, and returns how many
+// (0 once there are none left; see vr_diagram_source())
+typedef size_t (*vr_source_t)(void* arg, point_t* p, size_t n);
+
 struct vr_vertex
 {
 	point_t p;
 
-	// these fields are initialized
-	// but not filled automatically
-	size_t         n_edges;
+	// index in vr_diagram_t.vertices
+	size_t id;
+
+	// incident edges, filled by vr_diagram_end(); when streaming, the
+	// number of edges not streamed yet
+	size_t      n_edges;
 	vr_edge_t** edges;
 };
 
@@ -45,6 +62,26 @@ struct vr_edge
 
 	vr_region_t* ra;
 	vr_region_t* rb;
+
+	// index in vr_diagram_t.edges
+	size_t id;
+};
+
+// half-edges are built by vr_diagram_end(); each edge has two, going in
+// opposite directions, and each one has its region on its left ('r' is
+// NULL outside of the diagram); the half-edges around a region are
+// linked counter-clockwise
+struct vr_hedge
+{
+	point_t* a;
+	point_t* b;
+
+	vr_region_t* r;
+	vr_edge_t*   e;
+
+	vr_hedge_t* twin;
+	vr_hedge_t* next;
+	vr_hedge_t* prev;
 };
 
 struct vr_region
@@ -52,23 +89,63 @@ struct vr_region
 	// site
 	point_t p;
 
+	// index in vr_diagram_t.regions
+	size_t id;
+
+	// number of the site, in the order they were given; the same as
+	// 'id', unless regions are released (see vr_diagram_source())
+	size_t site;
+
+	// filled by vr_diagram_end(), but left empty when streaming;
+	// during the sweep, the number of arcs of the region on the
+	// beachline
 	size_t      n_edges;
 	vr_edge_t** edges;
+
+	// first half-edge of the boundary, NULL
+	// if the boundary could not be closed
+	vr_hedge_t* hedge;
 };
 
 struct vr_event
 {
 	// 0 if new vertex, 1 if circle
 	char is_circle;
-	char active;
 
 	vr_region_t* r;
 
-	// circle info
-	vr_vertex_t* p;
+	// circle info (the vertex is only created
+	// when the event is processed)
+	point_t     c;
 	vr_bnode_t* n;
+
+	// next released record
+	uint32_t next;
+};
+
+// where an edge leaves the box, to build the border edges
+struct vr_crossing
+{
+	double    pos; // along the border, from corner (0,0) through (0,h)
+	point_t   p;
+	point_t** end; // end of the clipped edge, NULL when streaming
+	point_t   sa;  // sites of the edge
+	point_t   sb;
+	size_t    ra;
+	size_t    rb;
 };
 
+// growable array of points
+struct vr_scratch
+{
+	size_t   avail;
+	point_t* p;
+};
+
+// vertices, edges and regions are carved out of blocks owned by the
+// diagram, so their addresses are stable; the 'a_' first entries of
+// each array point to allocated objects, and those past the 'n_' used
+// ones are reused after a vr_diagram_reset()
 struct vr_diagram
 {
 	double width;
@@ -82,26 +159,133 @@ struct vr_diagram
 	size_t      a_edges;
 	vr_edge_t** edges;
 
+	// two per edge, the one at 2*i+k goes from
+	// the k-th end to the other one of edge i
+	size_t      a_hedges;
+	vr_hedge_t* hedges;
+
+	// the edge lists of regions and vertices
+	// are slices of these arrays
+	size_t      a_region_edges;
+	vr_edge_t** region_edges;
+	size_t      a_vertex_edges;
+	vr_edge_t** vertex_edges;
+
 	size_t        n_regions;
 	size_t        a_regions;
 	vr_region_t** regions;
 
+	// blocks of vertices, edges and regions
+	size_t  n_blocks;
+	size_t  a_blocks;
+	void**  blocks;
+
+	// sites given in bulk are not queued as events
+	// but swept in order from this array, sorted
+	// by abscissa once before the sweep resumes;
+	// with a source, it holds the sites pulled
+	// from it and not swept yet
+	size_t        n_sites;
+	size_t        a_sites;
+	size_t        c_sites; // next site to sweep
+	vr_region_t** sites;
+	double*       site_keys; // sort keys, 'a_sites' of them
+	radix_t       sort;
+	char          sorted_sites;
+	size_t        n_given; // sites so far
+
+	vr_source_t   source;
+	void*         source_arg;
+	double        source_x;   // abscissa of the last site pulled
+	char          source_end; // all sites pulled
+	char          unsorted;   // a site came left of the one before
+
+	// the queue holds ids of event records; record 0
+	// is unused so that arcs can use it as 'no event'
 	heap_t        events;
+	size_t        n_pool;
+	size_t        a_pool;
+	vr_event_t*   pool;
+	uint32_t      pool_free; // first released record
+
 	vr_binbeach_t front;
 	double        sweepline;
+	size_t        a_breaks;
+	double*       breaks; // coordinates of the focuses and breakpoints
+	                      // when finishing, array by array
+
+	// bounded sweep (see vr_diagram_bounded())
+	char          bounded;
+	size_t        bound_wait; // steps before the beachline is checked again
+	char          stopped;    // the beachline has passed the box
+
+	// streaming (see vr_diagram_stream())
+	vr_sink_t      sink;
+	void*          sink_arg;
+	size_t         n_crossings;
+	size_t         a_crossings;
+	vr_crossing_t* crossings;
+
+	// scratch space for the users of the diagram, kept across
+	// calls and resets (see vr_diagram_scratch())
+	size_t        n_scratch;
+	vr_scratch_t* scratch;
+
+	// statistics
+	size_t n_cancelled;   // circle events removed before being reached
+	size_t n_rescheduled; // circle events moved before being reached
+	size_t n_skipped;     // events left when a bounded sweep stopped
 };
 
-void vr_diagram_init(vr_diagram_t* v, double w, double h);
+// n is the expected number of sites (0 if unknown), used to size
+// the arrays and pools up front
+void vr_diagram_init(vr_diagram_t* v, double w, double h, size_t n);
 void vr_diagram_exit(vr_diagram_t* v);
 
+// remove all sites and events, keeping the memory for the next diagram
+void vr_diagram_reset(vr_diagram_t* v);
+
+// vr_diagram_point() queues a site event; vr_diagram_points()
+// adds the sites to the sorted site stream
 void vr_diagram_point (vr_diagram_t* v, point_t p);
-void vr_diagram_points(vr_diagram_t* v, size_t n, point_t* p);
+void vr_diagram_points(vr_diagram_t* v, size_t n, const point_t* p);
+
+// abscissa of the next event (HUGE_VAL if none)
+double vr_diagram_next(vr_diagram_t* v);
 
+// vr_diagram_end() returns 0, leaving the diagram unfinished, if the
+// sites of a source were not sorted by abscissa
 char vr_diagram_step(vr_diagram_t* v);
-void vr_diagram_end (vr_diagram_t* v);
+char vr_diagram_end (vr_diagram_t* v);
+
+// pass the edges to sink (NULL to stop) as soon as both their ends are
+// known, instead of keeping them: each one is clipped to the box, given
+// with the ids of its regions and released, so that the memory used by
+// edges and vertices follows the size of the beachline; the border edges
+// (with VR_NONE as second region) are passed by vr_diagram_end(), which
+// builds nothing else
+void vr_diagram_stream(vr_diagram_t* v, vr_sink_t sink, void* arg);
+
+// pull the sites from src as the sweep reaches them, instead of taking
+// them from vr_diagram_points(); when streaming, each region is also
+// released once it has no arc left on the beachline, so that memory
+// does not depend on the number of sites; the sink then identifies
+// regions by the rank of their site in src
+void vr_diagram_source(vr_diagram_t* v, vr_source_t src, void* arg);
+
+// stop the sweep as soon as the beachline has passed the whole box,
+// since the events left could then only find vertices and cells out of
+// it; the edges of the breakpoints left are closed where they are, out
+// of the box, and clipped as usual; the events not processed (not
+// counting the sites not pulled from a source yet) are counted in
+// n_skipped
+void vr_diagram_bounded(vr_diagram_t* v, char bounded);
+
+// return at least n scratch arrays; each one can then be used
+// (and grown) by a different thread
+vr_scratch_t* vr_diagram_scratch(vr_diagram_t* v, size_t n);
 
-// after vr_diagram_end() has been called, use this to
-// fill in content that is not set automatically
-void vr_diagram_fill(vr_diagram_t* v);
+// make room for n points in s
+point_t* vr_scratch_reserve(vr_scratch_t* s, size_t n);
 
 #endif
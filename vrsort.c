@@ -0,0 +1,92 @@
+/*\
+ *  Voronoi diagram by Fortune's algorithm
+ *  Copyright (C) 2013-2014 Quentin SANTOS
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+\*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sitefile.h"
+
+// sorts a site file by abscissa, to sweep it with voronoi --file
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"Usage: %s [options] INPUT OUTPUT\n"
+		"Sorts the sites of INPUT (raw pairs of doubles) by abscissa into OUTPUT\n"
+		"\n"
+		"options:\n"
+		"  -h, --help        print this help\n"
+		"  -m, --memory M    use about M MiB of memory (default: 1024)\n"
+		, name
+	);
+	exit(1);
+}
+
+int main(int argc, char** argv)
+{
+	size_t mem = 1024;
+
+	int curarg = 1;
+	while (curarg < argc)
+	{
+		const char* option = argv[curarg++];
+		if (strcmp(option, "--help") == 0 || strcmp(option, "-h") == 0)
+		{
+			usage(argv[0]);
+		}
+		else if (strcmp(option, "--memory") == 0 || strcmp(option, "-m") == 0)
+		{
+			if (curarg >= argc)
+				usage(argv[0]);
+			mem = atoi(argv[curarg++]);
+		}
+		else
+		{
+			curarg--;
+			break;
+		}
+	}
+	if (argc - curarg != 2)
+		usage(argv[0]);
+
+	FILE* in = fopen(argv[curarg], "rb");
+	if (in == NULL)
+	{
+		fprintf(stderr, "Could not open '%s'\n", argv[curarg]);
+		return 1;
+	}
+	FILE* out = fopen(argv[curarg+1], "wb");
+	if (out == NULL)
+	{
+		fprintf(stderr, "Could not open '%s'\n", argv[curarg+1]);
+		return 1;
+	}
+
+	size_t n = vr_sitefile_sort(in, out, mem << 20);
+	fclose(in);
+
+	// the last writes may only fail when flushed
+	if (fclose(out) != 0)
+	{
+		fprintf(stderr, "Could not write sites to '%s'\n", argv[curarg+1]);
+		return 1;
+	}
+	fprintf(stderr, "%zu sites sorted\n", n);
+	return 0;
+}